@@ -0,0 +1 @@
+../src/util/myHashMix.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/util/myOutBuf.h
\ No newline at end of file
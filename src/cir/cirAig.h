@@ -0,0 +1,75 @@
+/****************************************************************************
+  FileName     [ cirAig.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define the flat AIG snapshot ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_AIG_H
+#define CIR_AIG_H
+
+#include <vector>
+#include <stddef.h>
+
+using namespace std;
+
+enum CirAigType
+{
+   AIG_NONE  = 0,    // no gate with this id
+   AIG_CONST = 1,
+   AIG_PI    = 2,
+   AIG_PO    = 3,
+   AIG_AND   = 4,
+   AIG_UNDEF = 5
+};
+
+//------------------------------------------------------------------------
+//   CirAig: a read-only snapshot of the CirGate netlist in flat arrays
+//   indexed by gate id. Each gate has two 32-bit fanin literals (id*2 +
+//   phase; a PO uses the first one only) and a type byte, about 9 bytes
+//   per AND, and the ANDs reachable from the POs are listed in topological
+//   order. The CirGates stay the netlist; simulation and the threaded
+//   fraig scan this copy instead of following CirGate pointers. CirMgr
+//   takes it when one of them needs it and releases it once the netlist
+//   changes.
+//------------------------------------------------------------------------
+class CirAig
+{
+public:
+   CirAig() {}
+
+   void reset(size_t nGate) {
+      _fanin.assign(2*nGate, 0);
+      _type.assign(nGate, AIG_NONE);
+      _andOrder.clear();
+   }
+   // Give the memory back, not only the contents
+   void release() {
+      vector<unsigned>().swap(_fanin);
+      vector<unsigned char>().swap(_type);
+      vector<unsigned>().swap(_andOrder);
+   }
+   void setGate(unsigned id, CirAigType t, unsigned lit0 = 0, unsigned lit1 = 0) {
+      _type[id] = (unsigned char)t;
+      _fanin[2*id] = lit0;
+      _fanin[2*id+1] = lit1;
+   }
+   void addOrder(unsigned id) { _andOrder.push_back(id); }
+
+   size_t size() const { return _type.size(); }
+   CirAigType type(unsigned id) const { return CirAigType(_type[id]); }
+   unsigned fanin(unsigned id, int i) const { return _fanin[2*id+i]; }
+   const unsigned* faninData() const { return _fanin.empty()? 0: &_fanin[0]; }
+   const vector<unsigned>& andOrder() const { return _andOrder; }
+
+   static unsigned litId(unsigned lit) { return lit >> 1; }
+   static bool litInv(unsigned lit) { return (lit & 1); }
+
+private:
+   vector<unsigned>       _fanin;      // 2 literals per gate id
+   vector<unsigned char>  _type;       // CirAigType per gate id
+   vector<unsigned>       _andOrder;   // ANDs of the DFS list, topological
+};
+
+#endif // CIR_AIG_H
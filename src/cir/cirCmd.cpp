@@ -12,6 +12,7 @@
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "cirCmd.h"
+#include "cirPattern.h"
 #include "util.h"
 
 using namespace std;
@@ -30,7 +31,8 @@ initCirCmd()
          cmdMgr->regCmd("CIRSTRash", 6, new CirStrashCmd) &&
          cmdMgr->regCmd("CIRSIMulate", 6, new CirSimCmd) &&
          cmdMgr->regCmd("CIRFraig", 4, new CirFraigCmd) &&
-         cmdMgr->regCmd("CIRWrite", 4, new CirWriteCmd)
+         cmdMgr->regCmd("CIRWrite", 4, new CirWriteCmd) &&
+         cmdMgr->regCmd("CIRCONVert", 7, new CirConvertCmd)
       )) {
       cerr << "Registering \"cir\" commands fails... exiting" << endl;
       return false;
@@ -66,13 +68,17 @@ CirReadCmd::exec(const string& option)
    if (options.empty())
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
 
-   bool doReplace = false;
+   bool doReplace = false, doStrash = false;
    string fileName;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Replace", options[i], 2) == 0) {
          if (doReplace) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
          doReplace = true;
       }
+      else if (myStrNCmp("-Strash", options[i], 2) == 0) {
+         if (doStrash) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         doStrash = true;
+      }
       else {
          if (fileName.size())
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -93,13 +99,14 @@ CirReadCmd::exec(const string& option)
    }
    cirMgr = new CirMgr;
 
-   if (!cirMgr->readCircuit(fileName)) {
+   if (!cirMgr->readCircuit(fileName, doStrash)) {
       curCmd = CIRINIT;
       delete cirMgr; cirMgr = 0;
       return CMD_EXEC_ERROR;
    }
 
-   curCmd = CIRREAD;
+   // A strashed read needs no CIRSTRash
+   curCmd = doStrash? CIRSTRASH: CIRREAD;
 
    return CMD_EXEC_DONE;
 }
@@ -107,7 +114,7 @@ CirReadCmd::exec(const string& option)
 void
 CirReadCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRRead <(string fileName)> [-Replace]" << endl;
+   os << "Usage: CIRRead <(string fileName)> [-Replace] [-Strash]" << endl;
 }
 
 void
@@ -374,8 +381,10 @@ CirStrashCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRSIMulate <-Random | -File <string patternFile>>
-//                [-Output (string logFile)]
+//    CIRSIMulate <-Random [-Words <(int 1|4|8)>] [-Threads <(int nThreads)>]
+//                         [-Seed <(int seed)>]
+//                | -File <string patternFile> [-Binary]>
+//                [-Output | -RAWOutput (string logFile)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirSimCmd::exec(const string& option)
@@ -389,8 +398,12 @@ CirSimCmd::exec(const string& option)
    CmdExec::lexOptions(option, options);
 
    ifstream patternFile;
+   CirPatternMap patternMap;
+   string patternName;
    ofstream logFile;
-   bool doRandom = false, doFile = false, doLog = false;
+   bool doRandom = false, doFile = false, doLog = false, doSeed = false;
+   bool doBinary = false, doRaw = false;
+   int nWords = 0, nThreads = 0, seed = 0;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Random", options[i], 2) == 0) {
          if (doRandom || doFile)
@@ -402,35 +415,91 @@ CirSimCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         patternFile.open(options[i].c_str(), ios::in);
-         if (!patternFile)
-            return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
+         patternName = options[i];
          doFile = true;
       }
-      else if (myStrNCmp("-Output", options[i], 2) == 0) {
+      else if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (doBinary)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         doBinary = true;
+      }
+      else if (myStrNCmp("-Output", options[i], 2) == 0 ||
+               myStrNCmp("-RAWOutput", options[i], 4) == 0) {
          if (doLog)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doRaw = (myStrNCmp("-RAWOutput", options[i], 4) == 0);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         logFile.open(options[i].c_str(), ios::out);
+         logFile.open(options[i].c_str(), doRaw? ios::out | ios::binary: ios::out);
          if (!logFile)
             return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
          doLog = true;
       }
+      else if (myStrNCmp("-Words", options[i], 2) == 0) {
+         if (nWords != 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nWords) ||
+             (nWords != 1 && nWords != 4 && nWords != 8))
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (nThreads != 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThreads) || nThreads < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Seed", options[i], 2) == 0) {
+         if (doSeed)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], seed) || seed < 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doSeed = true;
+      }
       else
          return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
    if (!doRandom && !doFile)
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
+   if (doFile && nWords != 0)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Words");
+   if (doFile && nThreads != 0)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Threads");
+   if (doFile && doSeed)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Seed");
+   if (doBinary && !doFile)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Binary");
+   if (doBinary) {
+      if (!patternMap.open(patternName))
+         return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, patternName);
+      if (!patternMap.isValid()) {
+         cerr << "Error: \"" << patternName << "\" is not a binary pattern file!!" << endl;
+         return CMD_EXEC_ERROR;
+      }
+   }
+   else if (doFile) {
+      patternFile.open(patternName.c_str(), ios::in);
+      if (!patternFile)
+         return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, patternName);
+   }
 
    assert (curCmd != CIRINIT);
    if (doLog)
-      cirMgr->setSimLog(&logFile);
+      cirMgr->setSimLog(&logFile, doRaw);
    else cirMgr->setSimLog(0);
 
+   if (doSeed)
+      cirMgr->setSimSeed(seed);
    if (doRandom)
-      cirMgr->randomSim();
+      cirMgr->randomSim(nWords == 0? 1: nWords, nThreads == 0? 1: nThreads);
+   else if (doBinary)
+      cirMgr->fileSim(patternMap);
    else
       cirMgr->fileSim(patternFile);
    cirMgr->setSimLog(0);
@@ -442,8 +511,10 @@ CirSimCmd::exec(const string& option)
 void
 CirSimCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRSIMulate <-Random | -File <string patternFile>>\n"
-      << "                   [-Output (string logFile)]" << endl;
+   os << "Usage: CIRSIMulate <-Random [-Words <(int 1|4|8)>] [-Threads <(int nThreads)>]\n"
+      << "                            [-Seed <(int seed)>]\n"
+      << "                   | -File <string patternFile> [-Binary]>\n"
+      << "                   [-Output | -RAWOutput (string logFile)]" << endl;
 }
 
 void
@@ -454,7 +525,7 @@ CirSimCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRFraig
+//    CIRFraig [-Conflicts <(int conflictLimit)>] [-Threads <(int nThreads)>]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirFraigCmd::exec(const string& option)
@@ -467,14 +538,37 @@ CirFraigCmd::exec(const string& option)
    vector<string> options;
    CmdExec::lexOptions(option, options);
 
-   if (!options.empty())
-      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+   int conflictLimit = -1, nThreads = 1;
+   bool doLimit = false, doThreads = false;
+   for (size_t i = 0, n = options.size(); i < n; ++i) {
+      if (myStrNCmp("-Conflicts", options[i], 2) == 0) {
+         if (doLimit)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         // A limit of 0 would leave every pair undecided
+         if (!myStr2Int(options[i], conflictLimit) || conflictLimit < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doLimit = true;
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (doThreads)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThreads) || nThreads < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doThreads = true;
+      }
+      else
+         return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+   }
 
    if (curCmd != CIRSIMULATE) {
       cerr << "Error: circuit is not yet simulated!!" << endl;
       return CMD_EXEC_ERROR;
    }
-   cirMgr->fraig();
+   cirMgr->fraig(conflictLimit, nThreads);
    curCmd = CIRFRAIG;
 
    return CMD_EXEC_DONE;
@@ -483,7 +577,8 @@ CirFraigCmd::exec(const string& option)
 void
 CirFraigCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRFraig" << endl;
+   os << "Usage: CIRFraig [-Conflicts <(int conflictLimit)>] "
+      << "[-Threads <(int nThreads)>]" << endl;
 }
 
 void
@@ -494,7 +589,7 @@ CirFraigCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRWrite [(int gateId)][-Output (string aagFile)]
+//    CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirWriteCmd::exec(const string& option)
@@ -511,17 +606,22 @@ CirWriteCmd::exec(const string& option)
       cirMgr->writeAag(cout);
       return CMD_EXEC_DONE;
    }
-   bool hasFile = false;
+   bool hasFile = false, binary = false;
    int gateId;
    CirGate *thisGate = NULL;
    ofstream outfile;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
-      if (myStrNCmp("-Output", options[i], 2) == 0) {
+      if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (binary)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         binary = true;
+      }
+      else if (myStrNCmp("-Output", options[i], 2) == 0) {
          if (hasFile) 
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         outfile.open(options[i].c_str(), ios::out);
+         outfile.open(options[i].c_str(), ios::out | ios::binary);
          if (!outfile)
             return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[1]);
          hasFile = true;
@@ -541,12 +641,15 @@ CirWriteCmd::exec(const string& option)
       }
       else return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
+   // binary AIGER is only written to a file
+   if (binary && !hasFile)
+      return CmdExec::errorOption(CMD_OPT_MISSING, "-Output");
 
    if (!thisGate) {
       assert (hasFile);
-      cirMgr->writeAag(outfile);
+      cirMgr->writeAag(outfile, binary);
    }
-   else if (hasFile) cirMgr->writeGate(outfile, thisGate);
+   else if (hasFile) cirMgr->writeGate(outfile, thisGate, binary);
    else cirMgr->writeGate(cout, thisGate);
 
    return CMD_EXEC_DONE;
@@ -555,13 +658,53 @@ CirWriteCmd::exec(const string& option)
 void
 CirWriteCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)]" << endl;
+   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]" << endl;
 }
 
 void
 CirWriteCmd::help() const
 {
    cout << setw(15) << left << "CIRWrite: "
-        << "write the netlist to an ASCII AIG file (.aag)\n";
+        << "write the netlist to an ASCII (.aag) or binary (.aig) AIG file\n";
+}
+
+//----------------------------------------------------------------------
+//    CIRCONVert <(string textFile)> <(string binFile)>
+//----------------------------------------------------------------------
+CmdExecStatus
+CirConvertCmd::exec(const string& option)
+{
+   if (!cirMgr) {
+      cerr << "Error: circuit is not yet constructed!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   // check option
+   vector<string> options;
+   if (!CmdExec::lexOptions(option, options, 2))
+      return CMD_EXEC_ERROR;
+
+   ifstream textFile(options[0].c_str(), ios::in);
+   if (!textFile)
+      return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[0]);
+   ofstream binFile(options[1].c_str(), ios::out | ios::binary);
+   if (!binFile)
+      return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[1]);
+   if (!cirMgr->convertPatterns(textFile, binFile))
+      return CMD_EXEC_ERROR;
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirConvertCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRCONVert <(string textFile)> <(string binFile)>" << endl;
+}
+
+void
+CirConvertCmd::help() const
+{
+   cout << setw(15) << left << "CIRCONVert: "
+        << "convert a pattern file to the binary pattern format\n";
 }
 
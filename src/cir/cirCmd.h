@@ -20,5 +20,6 @@ CmdClass(CirStrashCmd);
 CmdClass(CirSimCmd);
 CmdClass(CirFraigCmd);
 CmdClass(CirWriteCmd);
+CmdClass(CirConvertCmd);
 
 #endif // CIR_CMD_H
@@ -19,5 +19,8 @@ using namespace std;
 class CirGate;
 class CirMgr;
 class SatSolver;
+class CirPatternMap;
+class CirSimLog;
+class SimWorkers;
 
 #endif // CIR_DEF_H
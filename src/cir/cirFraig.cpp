@@ -7,6 +7,9 @@
 ****************************************************************************/
 
 #include <cassert>
+#include <iostream>
+#include <thread>
+#include <algorithm>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "sat.h"
@@ -21,10 +24,154 @@ using namespace std;
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
+// A pair to prove in the threaded fraig: gate against its representative
+struct FraigMerge
+{
+   FraigMerge(unsigned g, unsigned r, bool i) : _gate(g), _rep(r), _inv(i) {}
+   unsigned _gate;
+   unsigned _rep;
+   bool     _inv;
+};
+
+// One round of the threaded fraig. Worker w proves pairs w, w+nThreads, ...
+// and writes only to their slots, so the circuit and _repl stay read-only
+// until the results are committed.
+struct FraigQueue
+{
+   const CirAig*                      _aig;
+   vector<unsigned>                   _repl;       // literal replacing each id
+   vector<unsigned>                   _piIds;
+   unsigned                           _nThreads;
+   int                                _conflictLimit;
+   vector<FraigMerge>                 _pairs;
+   vector<lbool>                      _result;     // per pair
+   // The PI values of the SAT model of each pair, one per PI: 0 or 1, or
+   // 2 for a PI outside every encoded cone
+   vector<vector<unsigned char> >     _cex;
+};
 
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// Tseitin-encode the transitive fanin cone of g, stopping at gates that
+// already have a Var. The CNF therefore grows with the proven cones only.
+static void
+encodeCone(SatSolver& solver, CirGate * g)
+{
+   if(g->isEncoded()) return;
+   vector<CirGate *> stack(1, g);
+   while(!stack.empty()){
+      CirGate* gate = stack.back();
+      if(gate->isEncoded()){ stack.pop_back(); continue; }
+      if(gate->getTypeStr()=="PI"){
+         gate->setVar(solver.newVar());
+         stack.pop_back();
+         continue;
+      }
+      CirGate* fanin0 = gate->getfanin(0);
+      CirGate* fanin1 = gate->getfanin(1);
+      if(!fanin0->isEncoded()){ stack.push_back(fanin0); continue; }
+      if(!fanin1->isEncoded()){ stack.push_back(fanin1); continue; }
+      gate->setVar(solver.newVar());
+      solver.addAigCNF(gate->getVar(), fanin0->getVar(), gate->faninIsInv(0),
+                       fanin1->getVar(), gate->faninIsInv(1));
+      stack.pop_back();
+   }
+}
+
+// Solve the XOR miter of g1 and g2 (or of g1 and !g2 when inv).
+// l_False (UNSAT) means the pair is equivalent, l_True that it is not and
+// l_Undef that conflictLimit ran out first.
+static lbool
+proveEquivalence(SatSolver& solver, CirGate * g1, CirGate * g2, bool inv, int conflictLimit)
+{
+   encodeCone(solver, g1);
+   encodeCone(solver, g2);
+   Var miter = solver.newVar();
+   solver.addXorCNF(miter, g1->getVar(), false, g2->getVar(), inv);
+   solver.assumeRelease();
+   solver.assumeProperty(miter, true);
+   return solver.assumpSolveLimited(conflictLimit);
+}
+
+// Store the PI values of the last SAT model in bit "bit" of cexPattern.
+// PIs outside every encoded cone get a random value.
+static void
+recordCex(SatSolver& solver, const vector<CirGate *>& piList,
+          vector<bitset<SIZE_T> >& cexPattern, size_t bit)
+{
+   for(size_t i=0 ; i<piList.size() ; ++i){
+      if(piList[i]->isEncoded()) cexPattern[i][bit] = (solver.getValue(piList[i]->getVar())==1);
+      else cexPattern[i][bit] = rnGen(2);
+   }
+}
+
+// Same as encodeCone(), but over the flat store and with a gate-to-Var map
+// owned by one thread. Fanins go through repl, so the cones of gates
+// merged in earlier rounds are encoded on their representatives.
+static void
+encodeCone(SatSolver& solver, const CirAig& aig, const vector<unsigned>& repl,
+           unsigned g, vector<Var>& varOf)
+{
+   if(varOf[g]!=var_Undef) return;
+   vector<unsigned> stack(1, g);
+   while(!stack.empty()){
+      unsigned id = stack.back();
+      if(varOf[id]!=var_Undef){ stack.pop_back(); continue; }
+      if(aig.type(id)==AIG_PI){
+         varOf[id] = solver.newVar();
+         stack.pop_back();
+         continue;
+      }
+      unsigned lit0 = aig.fanin(id, 0), lit1 = aig.fanin(id, 1);
+      lit0 = repl[CirAig::litId(lit0)] ^ CirAig::litInv(lit0);
+      lit1 = repl[CirAig::litId(lit1)] ^ CirAig::litInv(lit1);
+      unsigned fanin0 = CirAig::litId(lit0), fanin1 = CirAig::litId(lit1);
+      if(varOf[fanin0]==var_Undef){ stack.push_back(fanin0); continue; }
+      if(varOf[fanin1]==var_Undef){ stack.push_back(fanin1); continue; }
+      varOf[id] = solver.newVar();
+      solver.addAigCNF(varOf[id], varOf[fanin0], CirAig::litInv(lit0),
+                       varOf[fanin1], CirAig::litInv(lit1));
+      stack.pop_back();
+   }
+}
+
+// One thread of one round of the threaded fraig. The solver and varOf are
+// kept by the caller for the whole run, so the cones encoded and the
+// clauses learnt in one round are reused by the following ones.
+static void
+fraigWorker(FraigQueue* queue, unsigned w, SatSolver* solver, vector<Var>* varOf)
+{
+   const CirAig& aig = *(queue->_aig);
+   if(varOf->empty()){
+      solver->initialize();
+      Var constVar = solver->newVar();
+      solver->assertProperty(constVar, false);
+      varOf->assign(aig.size(), var_Undef);
+      for(size_t i=0 ; i<aig.size() ; ++i){
+         if(aig.type(i)==AIG_CONST || aig.type(i)==AIG_UNDEF) (*varOf)[i] = constVar;
+      }
+   }
+   const vector<unsigned>& piIds = queue->_piIds;
+   for(size_t j=w ; j<queue->_pairs.size() ; j+=queue->_nThreads){
+      const FraigMerge& p = queue->_pairs[j];
+      encodeCone(*solver, aig, queue->_repl, p._rep, *varOf);
+      encodeCone(*solver, aig, queue->_repl, p._gate, *varOf);
+      Var miter = solver->newVar();
+      solver->addXorCNF(miter, (*varOf)[p._rep], false, (*varOf)[p._gate], p._inv);
+      solver->assumeRelease();
+      solver->assumeProperty(miter, true);
+      queue->_result[j] = solver->assumpSolveLimited(queue->_conflictLimit);
+      if(queue->_result[j] == l_True){
+         vector<unsigned char>& cex = queue->_cex[j];
+         cex.resize(piIds.size());
+         for(size_t i=0 ; i<piIds.size() ; ++i){
+            const Var v = (*varOf)[piIds[i]];
+            cex[i] = (v==var_Undef)? 2: (solver->getValue(v)==1);
+         }
+      }
+   }
+}
 
 /*******************************************/
 /*   Public member functions about fraig   */
@@ -35,41 +182,305 @@ CirMgr::strash()
 {
 	HashMap<faninKey, CirGate*> hashMap(_dfsList.size());
 	for(size_t i=0 ; i<_dfsList.size() ; ++i){
-		if(_dfsList[i]->getTypeStr()!="AIG") continue; 
-		faninKey key(_dfsList[i]->getfaninV(0), _dfsList[i]->getfaninV(1));
-		if(!hashMap.insert(key, _dfsList[i])){
+		CirGate* g = dfsGate(i);
+		if(g==0 || !g->isAig()) continue; 
+		faninKey key(g->getfaninV(0), g->getfaninV(1));
+		if(!hashMap.insert(key, g)){
 			CirGate* mergeGate;
 			hashMap.query(key, mergeGate);
-			str_merge(_dfsList[i], mergeGate);
+			str_merge(g, mergeGate);
 		}
 	}
-	dfsTraversal();
+	updateDfs();
 }
 
 void
 CirMgr::str_merge(CirGate * dgate, CirGate * mgate){
    _Andgate--;
    _totalList[dgate->getId()]=0;
-   for(int i=0, n=dgate->faninNum(); i<n ; ++i){
-      dgate->getfanin(i)->deletefanout(dgate);
+   moveFanouts(dgate, mgate, false);
+   cout<<"Strashing: "<<mgate->getId()<<" merging "<<dgate->getId()<<"..."<<endl;
+   dgate->releaseLists(_arena);
+}
+
+// One solver is kept for the whole run, so the clauses learnt while proving
+// one pair are reused by the following ones.
+// Gates are visited in DFS order and proven against the representative of
+// their group, its first gate in DFS order, so a gate is always merged into
+// a gate that cannot be in its fanout cone.
+// Every SAT model is packed into one bit of cexPattern; each SIZE_T models
+// are simulated at once to split all the groups they distinguish.
+// With conflictLimit >= 0, a pair not decided within that many conflicts is
+// skipped and reported instead of being merged.
+// With nThreads > 1, the groups are proven by fraigThreads() instead.
+void
+CirMgr::fraig(int conflictLimit, int nThreads)
+{
+   if(nThreads>1){ fraigThreads(conflictLimit, nThreads); return; }
+
+   SatSolver solver;
+   solver.initialize();
+   genProofModel(solver);
+
+   // DFS position of every gate; CONST 0 always goes first
+   _dfsOrder.assign(_totalList.size(), 0);
+   for(size_t i=0 ; i<_dfsList.size() ; ++i){
+      if(dfsGate(i)!=0) _dfsOrder[_dfsList[i]->getId()] = i+1;
+   }
+   _dfsOrder[0] = 0;
+
+   vector<bitset<SIZE_T> > cexPattern(_Pi);
+   size_t nCex = 0, undecided = 0;
+   size_t nCand = fecCandidateNum(), lastCand;
+   do{
+      lastCand = nCand;
+      sortAndRecord();
+      findFECReps();
+      for(size_t i=0 ; i<_dfsList.size() ; ++i){
+         // Gates that left the DFS in an earlier merge keep their group
+         // and are still merged
+         CirGate* gate = _dfsList[i];
+         if(gate==0 || !gate->isAig() || gate->getGrp()==SIZE_MAX) continue;
+         CirGate* repGate = _totalList[_fecReps[gate->getGrp()]];
+         if(repGate==gate) continue;
+         bool inv = (gate->getValue() != repGate->getValue());
+         lbool result = proveEquivalence(solver, repGate, gate, inv, conflictLimit);
+         if(result == l_True){
+            recordCex(solver, _piList, cexPattern, nCex++);
+            if(nCex==SIZE_T){ updateFECGrpsBySat(cexPattern, nCex); nCex = 0; }
+            continue;
+         }
+         gate->removeGrp();
+         if(result == l_False){
+            _dfsList[i] = 0;
+            fraig_merge(gate, repGate, inv);
+         }
+         else{
+            undecided++;
+            cout<<"Fraig: "<<repGate->getId()<<" and ";
+            if(inv){ cout<<"!"; }
+            cout<<gate->getId()<<" undecided..."<<endl;
+         }
+      }
+      if(nCex!=0){ updateFECGrpsBySat(cexPattern, nCex); nCex = 0; }
+      purgeFECGrps();
+      nCand = fecCandidateNum();
+   }while(nCand!=0 && nCand<lastCand);
+   if(undecided!=0){
+      cout<<undecided<<" pair(s) undecided within "<<conflictLimit<<" conflicts."<<endl;
+   }
+
+   for(size_t i=0 ; i<_fecGate.size() ; ++i){ _totalList[_fecGate[i]]->removeGrp(); }
+   _fecGate.clear();
+   _fecBegin.clear();
+   _fecReps.clear();
+   _dfsOrder.clear();
+   updateDfs();
+   _simFirst = true;
+}
+
+// The gates are proven in DFS order against the representative of their
+// group, as in the single-solver fraig, but in rounds of up to
+// SIZE_T*nThreads pairs shared out to nThreads threads. Each thread owns a
+// SatSolver for the whole run, and the circuit is not changed while they
+// run. After a round this thread commits the merges in DFS order, so the
+// later rounds encode merged gates by their representatives, and simulates
+// the SAT models to split the groups before the next round is taken.
+// Pairs are given to the threads in a fixed way, so the result does not
+// depend on the thread schedule.
+void
+CirMgr::fraigThreads(int conflictLimit, int nThreads)
+{
+   const unsigned nCores = thread::hardware_concurrency();
+   if(nCores!=0 && unsigned(nThreads)>nCores) nThreads = nCores;
+   if(nThreads<2){ fraig(conflictLimit, 1); return; }
+
+   // DFS position of every gate; CONST 0 always goes first
+   _dfsOrder.assign(_totalList.size(), 0);
+   for(size_t i=0 ; i<_dfsList.size() ; ++i){
+      if(dfsGate(i)!=0) _dfsOrder[_dfsList[i]->getId()] = i+1;
+   }
+   _dfsOrder[0] = 0;
+   if(!_aigReady){ buildAig(); }
+
+   const size_t nPi = _Pi;
+   vector<SatSolver> solvers(nThreads);
+   vector<vector<Var> > varOf(nThreads);
+   FraigQueue queue;
+   queue._aig = &_aig;
+   queue._repl.resize(_aig.size());
+   for(size_t i=0 ; i<_aig.size() ; ++i){ queue._repl[i] = i<<1; }
+   for(size_t i=0 ; i<nPi ; ++i){ queue._piIds.push_back(_piList[i]->getId()); }
+   queue._nThreads = nThreads;
+   queue._conflictLimit = conflictLimit;
+
+   vector<bitset<SIZE_T> > cexPattern(nPi);
+   size_t nCex = 0, undecided = 0;
+   size_t nCand = fecCandidateNum(), lastCand;
+   do{
+      lastCand = nCand;
+      sortAndRecord();
+      findFECReps();
+      for(size_t i=0 ; i<_dfsList.size() ; ){
+         // Take the next round; gates that left the DFS in an earlier
+         // merge keep their group and are still merged
+         queue._pairs.clear();
+         vector<size_t> pos;
+         for( ; i<_dfsList.size() && queue._pairs.size()<SIZE_T*nThreads ; ++i){
+            CirGate* gate = _dfsList[i];
+            if(gate==0 || !gate->isAig() || gate->getGrp()==SIZE_MAX) continue;
+            CirGate* repGate = _totalList[_fecReps[gate->getGrp()]];
+            if(repGate==gate) continue;
+            bool inv = (gate->getValue() != repGate->getValue());
+            queue._pairs.push_back(FraigMerge(gate->getId(), repGate->getId(), inv));
+            pos.push_back(i);
+         }
+         if(queue._pairs.empty()) break;
+         queue._result.assign(queue._pairs.size(), l_Undef);
+         queue._cex.assign(queue._pairs.size(), vector<unsigned char>());
+
+         vector<thread> workers;
+         for(int t=0 ; t<nThreads ; ++t){
+            workers.push_back(thread(fraigWorker, &queue, t, &solvers[t], &varOf[t]));
+         }
+         for(int t=0 ; t<nThreads ; ++t){ workers[t].join(); }
+
+         for(size_t j=0 ; j<queue._pairs.size() ; ++j){
+            const FraigMerge& p = queue._pairs[j];
+            CirGate* gate = _totalList[p._gate];
+            if(queue._result[j] == l_True){
+               const vector<unsigned char>& cex = queue._cex[j];
+               for(size_t k=0 ; k<nPi ; ++k){
+                  cexPattern[k][nCex] = (cex[k]==2)? rnGen(2): cex[k];
+               }
+               if(++nCex==SIZE_T){ updateFECGrpsBySat(cexPattern, nCex); nCex = 0; }
+               continue;
+            }
+            gate->removeGrp();
+            if(queue._result[j] == l_False){
+               _dfsList[pos[j]] = 0;
+               queue._repl[p._gate] = (p._rep<<1) | p._inv;
+               fraig_merge(gate, _totalList[p._rep], p._inv);
+            }
+            else{
+               undecided++;
+               cout<<"Fraig: "<<p._rep<<" and ";
+               if(p._inv){ cout<<"!"; }
+               cout<<p._gate<<" undecided..."<<endl;
+            }
+         }
+         if(nCex!=0){ updateFECGrpsBySat(cexPattern, nCex); nCex = 0; }
+      }
+      purgeFECGrps();
+      nCand = fecCandidateNum();
+   }while(nCand!=0 && nCand<lastCand);
+   if(undecided!=0){
+      cout<<undecided<<" pair(s) undecided within "<<conflictLimit<<" conflicts."<<endl;
+   }
+
+   for(size_t i=0 ; i<_fecGate.size() ; ++i){ _totalList[_fecGate[i]]->removeGrp(); }
+   _fecGate.clear();
+   _fecBegin.clear();
+   _fecReps.clear();
+   _dfsOrder.clear();
+   updateDfs();
+   _simFirst = true;
+}
+
+void
+CirMgr::fraig_merge(CirGate * dgate, CirGate * mgate, bool inv){
+   _Andgate--;
+   _totalList[dgate->getId()]=0;
+   moveFanouts(dgate, mgate, inv);
+   cout<<"Fraig: "<<mgate->getId()<<" merging ";
+   if(inv){ cout<<"!"; }
+   cout<<dgate->getId()<<"..."<<endl;
+   dgate->releaseLists(_arena);
+}
+
+// Only set up CONST 0 here; gates are encoded lazily by encodeCone().
+// UNDEF gates share the CONST 0 variable, the same value simulation gives
+// them, so a SAT model always separates the pair it was found for.
+void
+CirMgr::genProofModel(SatSolver& solver)
+{
+   Var constVar = solver.newVar();
+   solver.assertProperty(constVar, false);
+   for(size_t i=0 ; i<_totalList.size() ; ++i){
+      if(_totalList[i]==0) continue;
+      if(i==0 || _totalList[i]->getTypeStr()=="UNDEF") _totalList[i]->setVar(constVar);
+      else _totalList[i]->setVar(var_Undef);
    }
-   for(int i=0, n=dgate->fanoutNum(); i<n ; ++i){
-      if(!dgate->fanoutIsInv(i)){
-         dgate->getfanout(i)->chagefanin(dgate, mgate, 0);
-         mgate->addfanout(dgate->getfanout(i), 0);
+}
+
+// Simulate the first nCex patterns of cexPattern (the rest is filled
+// randomly) and split the FEC groups with the result.
+// simulate() keeps the netlist flattened before the merges, which has the
+// same functions, so gates cut off from the POs by a merge are still
+// evaluated.
+void
+CirMgr::updateFECGrpsBySat(vector<bitset<SIZE_T> >& cexPattern, size_t nCex)
+{
+   if(nCex<SIZE_T){
+      const bitset<SIZE_T> kept((size_t(1)<<nCex)-1);
+      const size_t nPi = _Pi;
+      for(size_t i=0 ; i<nPi ; ++i){
+         cexPattern[i] = (cexPattern[i] & kept) | (bitset<SIZE_T>(_simGen()) & ~kept);
       }
-      else{
-         dgate->getfanout(i)->chagefanin(dgate, mgate, 1);
-         mgate->addfanout(dgate->getfanout(i), 1);
+   }
+   simulate(&cexPattern[0]);
+   purgeFECGrps();
+   splitFECGrps();
+   cout<<endl;
+   sortAndRecord();
+   findFECReps();
+}
+
+// The representative of each group is its first gate in DFS order.
+void
+CirMgr::findFECReps()
+{
+   _fecReps.resize(fecGrpNum());
+   for(size_t i=0 ; i<fecGrpNum() ; ++i){
+      unsigned rep = _fecGate[_fecBegin[i]];
+      for(size_t k=_fecBegin[i]+1 ; k<_fecBegin[i+1] ; ++k){
+         if(_dfsOrder[_fecGate[k]] < _dfsOrder[rep]) rep = _fecGate[k];
       }
+      _fecReps[i] = rep;
    }
-   cout<<"Strashing: "<<mgate->getId()<<" merging "<<dgate->getId()<<"..."<<endl;
-   delete dgate;
 }
 
+// Drop the gates merged or given up on (grp already removed) from the FEC
+// groups, and the groups left with a single gate. The group indices in the
+// gates are stale until the next sortAndRecord().
 void
-CirMgr::fraig()
+CirMgr::purgeFECGrps()
+{
+   size_t out = 0, nGrp = 0;
+   for(size_t i=0 ; i<fecGrpNum() ; ++i){
+      const size_t begin = out;
+      for(size_t k=_fecBegin[i] ; k<_fecBegin[i+1] ; ++k){
+         unsigned id = _fecGate[k];
+         if(id==0 || (_totalList[id]!=0 && _totalList[id]->getGrp()!=SIZE_MAX)){
+            _fecGate[out++] = id;
+         }
+      }
+      if(out-begin==1){ _totalList[_fecGate[begin]]->removeGrp(); }
+      if(out-begin<2){ out = begin; continue; }
+      _fecBegin[nGrp++] = begin;
+   }
+   if(!_fecBegin.empty()){
+      _fecBegin[nGrp] = out;
+      _fecBegin.resize(nGrp+1);
+   }
+   _fecGate.resize(out);
+}
+
+// Number of gates still to be proven against their representative
+size_t
+CirMgr::fecCandidateNum() const
 {
+   return _fecGate.size()-fecGrpNum();
 }
 
 /********************************************/
@@ -31,37 +31,37 @@ unsigned CirGate::_globalRef=0;
 /*******************************************************/
 CirGate* 
 CirGate::getfanin(int i){ 
-   if(_faninList.size()>i) return _faninList[i].gate();
+   if(_faninList.size()>i) return fanin(i).gate();
    else return 0;
 }
 
 CirGate*
 CirGate::getfanout(int i) { 
-   if(_fanoutList.size()>i) return _fanoutList[i].gate();
+   if(_fanoutNum>i) return _fanout[i].gate();
    else return 0; 
 }
 
 bool 
 CirGate::faninIsInv(int i) { 
-   if(_faninList.size()>i) return _faninList[i].isInv();
+   if(_faninList.size()>i) return fanin(i).isInv();
    else return 0;
 }
 
 bool
 CirGate::fanoutIsInv(int i) { 
-   if(_fanoutList.size()>i) return _fanoutList[i].isInv();
+   if(_fanoutNum>i) return _fanout[i].isInv();
    else return 0; 
 }
 
 size_t 
 CirGate::getfaninV(int i){
-	if(_faninList.size()>i) return _faninList[i]._gateV;
+	if(_faninList.size()>i) return fanin(i)._gateV;
    else return 0; 
 }
 
 size_t 
 CirGate::getfanoutV(int i){
-	if(_fanoutList.size()>i) return _fanoutList[i]._gateV;
+	if(_fanoutNum>i) return _fanout[i]._gateV;
    else return 0; 
 }
 
@@ -103,29 +103,7 @@ CirGate::reportFanin(int level) const
 {
    assert (level >= 0);
    setGlobalRef();
-   printFanin(level, 0, false);
-}
-
-void
-CirGate::printFanin(int level, int space, bool isInvert) const
-{
-	for(int i=0 ; i<space ; ++i){
-		cout<<"  ";
-	}
-	if(isInvert) cout<<"!";
-	cout<<getTypeStr()<<" "<<_id;
-	if(_ref!=_globalRef){
-		cout<<endl;
-		if(level>0){
-			for(int i=0 ; i<_faninList.size() ; ++i){
-				_ref=_globalRef;
-				_faninList[i].gate()->printFanin(level-1, space+1, _faninList[i].isInv());
-			}
-		}
-	}
-	else{
-		cout<<" (*)"<<endl;
-	}
+   printTree(level, false);
 }
 
 void
@@ -133,28 +111,52 @@ CirGate::reportFanout(int level) const
 {
    assert (level >= 0);
    setGlobalRef();
-   printFanout(level, 0, false);
+   printTree(level, true);
 }
 
+// Print the fanin (or fanout) tree down to "level", one gate per line
+// indented by its depth. A gate whose subtree was already printed is
+// marked (*) and not expanded again. The stack holds the gates being
+// expanded, so the depth is not limited by the call stack.
 void
-CirGate::printFanout(int level, int space, bool isInvert) const
+CirGate::printTree(int level, bool fanout) const
 {
-	for(int i=0 ; i<space ; ++i){
-		cout<<"  ";
-	}
-	if(isInvert) cout<<"!";
-	cout<<getTypeStr()<<" "<<_id;
-	if(_ref!=_globalRef){
-		cout<<endl;
-		if(level>0){
-			for(int i=0 ; i<_fanoutList.size() ; ++i){
-				_ref=_globalRef;
-				_fanoutList[i].gate()->printFanout(level-1, space+1, _fanoutList[i].isInv());
+	struct Frame { const CirGate* _gate; int _level; unsigned _next; };
+	vector<Frame> stack;
+	const CirGate* g = this;
+	bool isInvert = false;
+	while(g!=0){
+		for(size_t i=0 ; i<stack.size() ; ++i){
+			cout<<"  ";
+		}
+		if(isInvert) cout<<"!";
+		cout<<g->getTypeStr()<<" "<<g->_id;
+		if(g->_ref!=_globalRef){
+			cout<<endl;
+			if(level>0){
+				Frame f = { g, level, 0 };
+				stack.push_back(f);
 			}
 		}
-	}
-	else{
-		cout<<" (*)"<<endl;
+		else{
+			cout<<" (*)"<<endl;
+		}
+		// Next gate: the next child of the deepest unfinished gate
+		g = 0;
+		while(!stack.empty()){
+			Frame& f = stack.back();
+			const size_t n = fanout? f._gate->_fanoutNum: f._gate->_faninList.size();
+			if(f._next<n){
+				const GateV v = fanout? f._gate->_fanout[f._next]: f._gate->fanin(f._next);
+				++f._next;
+				f._gate->_ref = _globalRef;
+				g = v.gate();
+				isInvert = v.isInv();
+				level = f._level-1;
+				break;
+			}
+			stack.pop_back();
+		}
 	}
 }
 
@@ -163,7 +165,7 @@ CirGate::printFanout(int level, int space, bool isInvert) const
 /*    class CirGate member functions for changing      */
 /*******************************************************/
 void 
-CirGate::deletefanin(int i){ _faninList.erase(_faninList.begin()+i); }
+CirGate::deletefanin(int i){ _faninList.erase(i); }
 void
 CirGate::deletefanin(CirGate * faningate){
 	for(int i=0 ; i<_faninList.size() ; ++i){
@@ -174,96 +176,76 @@ CirGate::deletefanin(CirGate * faningate){
 	}
 }
 
-void 
-CirGate::deletefanout(int i){ _fanoutList.erase(_fanoutList.begin()+i); }
-void
-CirGate::deletefanout(CirGate * fanoutgate){
-	for(int i=0 ; i<_fanoutList.size() ; ++i){
-		if(_fanoutList[i].gate()==fanoutgate){
-			deletefanout(i);
-			break;
-		}
+// The gate that finally replaces v.gate(), with the phases on the way
+// folded into the phase of v. The links passed are shortened to point to
+// that gate directly.
+GateV
+CirGate::resolve(const GateV& v)
+{
+	CirGate* g = v.gate();
+	if(g->_repl==0) return v;
+	size_t phase = 0;
+	CirGate* root = g;
+	while(root->_repl!=0){
+		phase ^= (root->_repl & NEG);
+		root = (CirGate*)(root->_repl & ~size_t(NEG));
 	}
-}
-
-void
-CirGate::chagefanin(CirGate* oldfanin, CirGate* newfanin, size_t phase){
-	for(int i=0 ; i<_faninList.size() ; ++i){
-		if(_faninList[i].gate()==oldfanin){
-			_faninList[i]=GateV(newfanin, phase);
-			break;
-		}
+	for(size_t p=phase ; g!=root ; ){
+		const size_t next = g->_repl;
+		g->_repl = size_t(root) + p;
+		p ^= (next & NEG);
+		g = (CirGate*)(next & ~size_t(NEG));
 	}
+	return GateV(root, v.isInv()!=bool(phase));
 }
 
 void
-CirGate::chagefanout(CirGate* oldfanout, CirGate* newfanout, size_t phase){
-	for(int i=0 ; i<_fanoutList.size() ; ++i){
-		if(_fanoutList[i].gate()==oldfanout){
-			_fanoutList[i]=GateV(newfanout, phase);
-			break;
-		}
-	}
+CirGate::resolveFanins()
+{
+	for(size_t i=0 ; i<_faninList.size() ; ++i){ _faninList[i] = fanin(i); }
 }
 
 /*******************************************************/
 /*       class CirGate member functions for DFS        */
 /*******************************************************/
+// Append the gates in the fanin cones of roots to dfsList in post-order
+// (fanins first), using an explicit stack of (gate, next fanin). Gates
+// visited since the last setGlobalRef() are skipped. The level of every
+// listed gate is computed on the way back. UNDEF gates are not listed.
 void 
-CirGate::dfsTraversal(vector<CirGate *>& dfsList)
+CirGate::dfsTraversal(CirGate* const* roots, size_t nRoots, vector<CirGate *>& dfsList)
 {
-	if(getTypeStr()!="UNDEF"){
-		if(getTypeStr()!="PI" && getTypeStr()!="CONST"){
-			for(int i=0 ; i<_faninList.size() ; ++i){
-				if(getfanin(i)->_ref!=_globalRef){
-					getfanin(i)->_ref=_globalRef;
-					getfanin(i)->dfsTraversal(dfsList);
+	vector<pair<CirGate *, unsigned> > stack;
+	for(size_t r=0 ; r<nRoots ; ++r){
+		if(roots[r]->_ref==_globalRef) continue;
+		roots[r]->_ref = _globalRef;
+		stack.push_back(make_pair(roots[r], 0u));
+		while(!stack.empty()){
+			CirGate* g = stack.back().first;
+			if(stack.back().second < g->_faninList.size()){
+				CirGate* fanin = g->fanin(stack.back().second++).gate();
+				if(fanin->_ref!=_globalRef){
+					fanin->_ref = _globalRef;
+					stack.push_back(make_pair(fanin, 0u));
 				}
+				continue;
 			}
+			stack.pop_back();
+			if(g->isUndef()) continue;
+			g->updateLevel();
+			dfsList.push_back(g);
 		}
-		_indfs = true;
-		dfsList.push_back(this);
 	}
-	else{ _indfs = true; }
 }
 
-/*******************************************************/
-/*    class CirGate member functions for Simulation    */
-/*******************************************************/
-bool 
-CirGate::simulate(bool& _simFirst)
+// The level of a gate from the levels of its fanins
+void
+CirGate::updateLevel()
 {
-	size_t simValue = 0;
-	bool faninIsChange = false;
+	unsigned level = 0;
 	for(size_t i=0 ; i<_faninList.size() ; ++i){
-		string faninType = _faninList[i].gate()->getTypeStr();
-		if(faninType!="CONST" && faninType!="PI" && _faninList[i].gate()->_ref!=_globalRef){
-			if(_faninList[i].gate()->simulate(_simFirst)){ faninIsChange = true; }
-		}
-		else{ faninIsChange = true; }
-	}
-	if(!_simFirst){ if(!faninIsChange){ _ref = _globalRef; return false; }}
-	if(_faninList[0].isInv()){
-		if(_faninList[1].isInv()){
-			simValue = _faninList[0].gate()->getValue() | _faninList[1].gate()->getValue();
-			simValue = ~simValue;
-		}
-		else{
-			size_t tempValue = ~_faninList[0].gate()->getValue();
-			simValue = tempValue & _faninList[1].gate()->getValue();
-		}
-	}
-	else{
-		if(_faninList[1].isInv()){
-			size_t tempValue = ~_faninList[1].gate()->getValue();
-			simValue = _faninList[0].gate()->getValue() & tempValue;
-		}
-		else{
-			simValue = _faninList[0].gate()->getValue() & _faninList[1].gate()->getValue();
-		}
+		CirGate* g = fanin(i).gate();
+		if(g->_level>level) level = g->_level;
 	}
-	_ref = _globalRef;
-	if(!_simFirst){ if(simValue == _value){ return false; }}
-	_value = simValue;
-	return true;
+	_level = isAig()? level+1: level;
 }
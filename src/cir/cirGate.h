@@ -14,7 +14,9 @@
 #include <iostream>
 #include <algorithm>
 #include <stddef.h>
+#include <cstring>
 #include "cirDef.h"
+#include "myArena.h"
 #include "sat.h"
 
 using namespace std;
@@ -38,10 +40,50 @@ public:
    size_t _gateV;
 };
 
+// A fanin list kept in the Arena of the circuit. It grows by
+// doubling and returns the old storage to the arena, so nothing of it has
+// to be freed when the gates are released in bulk.
+class GateVList {
+public:
+   GateVList() : _data(0), _size(0), _cap(0) {}
+
+   size_t size() const { return _size; }
+   bool empty() const { return (_size==0); }
+   GateV& operator [] (size_t i) { return _data[i]; }
+   const GateV& operator [] (size_t i) const { return _data[i]; }
+   GateV* begin() { return _data; }
+   GateV* end() { return _data + _size; }
+
+   void push_back(const GateV& v, Arena& arena) {
+      if(_size==_cap){
+         unsigned cap = (_cap==0)? 2: 2*_cap;
+         GateV* data = (GateV*)arena.alloc(cap*sizeof(GateV));
+         if(_size!=0) memcpy(data, _data, _size*sizeof(GateV));
+         arena.free(_data, _cap*sizeof(GateV));
+         _data = data;
+         _cap = cap;
+      }
+      _data[_size++] = v;
+   }
+   void erase(size_t i) {
+      memmove(_data+i, _data+i+1, (_size-i-1)*sizeof(GateV));
+      --_size;
+   }
+   void release(Arena& arena) {
+      arena.free(_data, _cap*sizeof(GateV));
+      _data = 0; _size = _cap = 0;
+   }
+
+private:
+   GateV*   _data;
+   unsigned _size;
+   unsigned _cap;
+};
+
 class CirGate
 {
 public:
-   CirGate(unsigned d, unsigned l=0) : _id(d), _lineNo(l), _ref(0), _indfs(false), _value(0){}
+   CirGate(unsigned d, unsigned l=0) : _fanout(0), _fanoutNum(0), _repl(0), _id(d), _lineNo(l), _ref(0), _indfs(false), _dfsRef(0), _level(0), _value(0), _var(var_Undef){}
    virtual ~CirGate() {}
 
    // Basic access methods
@@ -49,9 +91,10 @@ public:
    unsigned getLineNo() const { return _lineNo; }
    unsigned getId() const { return _id; }
    virtual bool isAig() const { return false; }
+   virtual bool isUndef() const { return false; }
    virtual string getName() const { return ""; }
    virtual bool haveName() const { return false; }
-   size_t fanoutNum() const { return _fanoutList.size(); }
+   size_t fanoutNum() const { return _fanoutNum; }
    size_t faninNum() const { return _faninList.size(); }
    CirGate* getfanin(int i);
    CirGate* getfanout(int i);
@@ -65,51 +108,74 @@ public:
    virtual void printGate() const = 0;  // Using by printNetlist
    void reportGate() const;
    void reportFanin(int level) const;
-   void printFanin(int level, int space, bool isInvert) const;
    void reportFanout(int level) const;
-   void printFanout(int level, int space, bool isInvert) const;
+   void printTree(int level, bool fanout) const;
 
    // Read aag functions
-   void addfanin(CirGate* faninG, size_t phase){ _faninList.push_back(GateV(faninG, phase));}
-   void addfanout(CirGate* fanoutG, size_t phase){ _fanoutList.push_back(GateV(fanoutG, phase));}
-   virtual void addName(string n) {}
+   void addfanin(CirGate* faninG, size_t phase, Arena& arena){ _faninList.push_back(GateV(faninG, phase), arena);}
+   virtual void addName(const string& n, Arena& arena) {}
+   // Give the fanin storage back to the arena before removing the gate
+   void releaseLists(Arena& arena){ _faninList.release(arena); setFanout(0, 0); }
 
-   // Fanin fanout chage functions
+   // Fanin chage functions
    void deletefanin(int i);
    void deletefanin(CirGate * faningate);
-   void deletefanout(int i);
-   void deletefanout(CirGate * fanoutgate);
-   void chagefanin(CirGate* oldfanin, CirGate* newfanin, size_t phase);
-   void chagefanout(CirGate* oldfanout, CirGate* newfanout, size_t phase);
 
-   // Sort Fanout List
-   void sortFanout(){ sort(_fanoutList.begin(), _fanoutList.end(), compareFanout); }
-   static bool compareFanout(GateV & V1, GateV & V2) { return (V1.gate()->getId() < V2.gate()->getId()); }
+   // Merged gates: a gate replaced by another (inverted or not) keeps
+   // pointing to it, and fanins are read through these links, so a merge
+   // does not touch the fanouts. resolveFanins() stores the final gates.
+   void setRepl(const GateV& v){ _repl = v._gateV; }
+   bool isReplaced() const { return (_repl!=0); }
+   static GateV resolve(const GateV& v);
+   void resolveFanins();
+
+   // Fanouts are a slice of the fanout index of CirMgr, set by buildFanout()
+   void setFanout(GateV* fanout, unsigned n){ _fanout = fanout; _fanoutNum = n; }
 
    //DFS
-   void dfsTraversal(vector<CirGate *>& dfsList);
+   static void dfsTraversal(CirGate* const* roots, size_t nRoots, vector<CirGate *>& dfsList);
+   void dfsTraversal(vector<CirGate *>& dfsList){ CirGate* root = this; dfsTraversal(&root, 1, dfsList); }
+   unsigned getLevel() const { return _level; }
+   void updateLevel();
    static void setGlobalRef(){ _globalRef++; }
    static void resetGlobalRef(){ _globalRef=0; }
-   bool isindfs(){ return(_indfs); }
+   bool isindfs() const { return(_indfs); }
+   void setInDfs(bool b){ _indfs = b; }
+   // Fanin edges from gates in the DFS list that point to this gate
+   unsigned dfsRef() const { return _dfsRef; }
+   void setDfsRef(unsigned n){ _dfsRef = n; }
+   unsigned incDfsRef(){ return _dfsRef++; }
+   unsigned decDfsRef(){ return --_dfsRef; }
 
    //Simulation
    void setValue(size_t v){ _ref=_globalRef; _value = v; }
    size_t getValue(){ return _value; }
-   virtual bool simulate(bool& _simFirst);
    virtual void setGrp(size_t g){}
    virtual size_t getGrp() const {return SIZE_MAX;}
    virtual void removeGrp(){}
 
+   //Fraig
+   void setVar(const Var& v){ _var = v; }
+   Var getVar() const { return _var; }
+   bool isEncoded() const { return (_var!=var_Undef); }
+
 
 protected:
-   vector<GateV> _faninList;
-   vector<GateV> _fanoutList;
+   GateV fanin(size_t i) const { return resolve(_faninList[i]); }
+
+   GateVList _faninList;
+   GateV*    _fanout;
+   unsigned  _fanoutNum;
+   size_t    _repl;     // GateV of the replacing gate, 0 if not merged
    unsigned _id;
    unsigned _lineNo;
    bool _indfs;
+   unsigned _dfsRef;
+   unsigned _level;     // AIGs on the longest path from a PI, set by DFS
    static unsigned _globalRef;
    mutable unsigned _ref;
    size_t _value;
+   Var _var;
 
 };
 
@@ -119,62 +185,60 @@ public:
    UndefGate(unsigned d, unsigned l) : CirGate(d, 0){}
 
    virtual string getTypeStr() const { return "UNDEF";}
+   virtual bool isUndef() const { return true; }
    virtual void printGate() const{}
-   virtual bool simulate(bool& _simFirst){ 
-      if(_simFirst) return true; 
-      else return false;
-   }
 
 };
 
+// Names are copied into the arena as C strings so that a gate owns no heap
+// memory of its own
+static inline const char*
+arenaStr(const string& s, Arena& arena)
+{
+   char* p = (char*)arena.alloc(s.size()+1);
+   memcpy(p, s.c_str(), s.size()+1);
+   return p;
+}
+
 class PiGate : public CirGate{
 public:
-   PiGate(unsigned d, unsigned l) : CirGate(d, l), _name(""){}
+   PiGate(unsigned d, unsigned l) : CirGate(d, l), _name(0){}
 
    virtual string getTypeStr() const { return "PI";}
-   virtual string getName() const { return _name; }
-   virtual bool haveName() const { return (_name!=""); }
-   virtual void addName(string n){ _name = n; }
+   virtual string getName() const { return (_name!=0)? _name: ""; }
+   virtual bool haveName() const { return (_name!=0 && _name[0]!=0); }
+   virtual void addName(const string& n, Arena& arena){ _name = arenaStr(n, arena); }
    virtual void printGate() const{
       cout<<"PI  "<<_id;
-      if(_name!=""){ cout<<" ("<<_name<<")"; }
+      if(haveName()){ cout<<" ("<<_name<<")"; }
       cout<<endl;
    }
-   virtual bool simulate(bool& _simFirst){ return true; }
 
 protected:
-   string _name;
+   const char* _name;
 
 };
 
 class PoGate : public CirGate{
 public:
-   PoGate(unsigned d, unsigned l) : CirGate(d, l), _name(""){}
+   PoGate(unsigned d, unsigned l) : CirGate(d, l), _name(0){}
 
    virtual string getTypeStr() const { return"PO"; }
-   virtual string getName() const { return _name; }
-   virtual bool haveName() const { return (_name!=""); }
-   virtual void addName(string n){ _name = n; }
+   virtual string getName() const { return (_name!=0)? _name: ""; }
+   virtual bool haveName() const { return (_name!=0 && _name[0]!=0); }
+   virtual void addName(const string& n, Arena& arena){ _name = arenaStr(n, arena); }
    virtual void printGate() const{
       cout<<"PO  "<<_id<<" ";
-      if(_faninList[0].gate()->getTypeStr()=="UNDEF") cout<<"*";
-      if(_faninList[0].isInv()) cout<<"!";
-      cout<<_faninList[0].gate()->getId();
-      if(_name!=""){ cout<<" ("<<_name<<")"; }
+      const GateV v = fanin(0);
+      if(v.gate()->getTypeStr()=="UNDEF") cout<<"*";
+      if(v.isInv()) cout<<"!";
+      cout<<v.gate()->getId();
+      if(haveName()){ cout<<" ("<<_name<<")"; }
       cout<<endl;
    }
-   virtual bool simulate(bool& _simFirst){
-      string faninType = _faninList[0].gate()->getTypeStr();
-      if(faninType!="CONST" && faninType!="PI"){
-         if(!_faninList[0].gate()->simulate(_simFirst)){ if(!_simFirst) return false; }
-      }
-      if(_faninList[0].isInv()){ _value = ~_faninList[0].gate()->getValue(); }
-      else{ _value = _faninList[0].gate()->getValue(); }
-      return true;
-   }
 
 protected:
-   string _name;
+   const char* _name;
 
 };
 
@@ -187,10 +251,11 @@ public:
    virtual void printGate() const{
       cout<<"AIG "<<_id;
       for(int i=0 ; i<_faninList.size() ; ++i){
+         const GateV v = fanin(i);
          cout<<" ";
-         if(_faninList[i].gate()->getTypeStr()=="UNDEF") cout<<"*";
-         if(_faninList[i].isInv()) cout<<"!";
-         cout<<_faninList[i].gate()->getId();
+         if(v.gate()->getTypeStr()=="UNDEF") cout<<"*";
+         if(v.isInv()) cout<<"!";
+         cout<<v.gate()->getId();
       }
       cout<<endl;
    }
@@ -208,10 +273,6 @@ public:
 
    virtual string getTypeStr() const { return"CONST";}
    virtual void printGate() const{ cout<<"CONST0"<<endl; }
-   virtual bool simulate(bool& _simFirst){ 
-      if( _simFirst) return true;
-      else return false;
-   }
 
 };
 
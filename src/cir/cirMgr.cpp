@@ -15,9 +15,14 @@
 #include <cstring>
 #include <sstream>
 #include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
+#include "myOutBuf.h"
 
 using namespace std;
 
@@ -61,6 +66,94 @@ static string errMsg;
 static int errInt;
 static CirGate *errGate;
 
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+   MappedFile() : _data(0), _size(0) {}
+   ~MappedFile() { if(_data!=0) munmap((void*)_data, _size); }
+
+   bool open(const string& fileName) {
+      int fd = ::open(fileName.c_str(), O_RDONLY);
+      if(fd<0) return false;
+      struct stat st;
+      if(fstat(fd, &st)!=0 || !S_ISREG(st.st_mode)){ close(fd); return false; }
+      _size = st.st_size;
+      if(_size!=0){
+         void* addr = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if(addr==MAP_FAILED){ close(fd); return false; }
+         madvise(addr, _size, MADV_SEQUENTIAL);
+         _data = (const char*)addr;
+      }
+      close(fd);
+      return true;
+   }
+   const char* begin() const { return _data; }
+   const char* end() const { return _data+_size; }
+
+private:
+   const char*  _data;
+   size_t       _size;
+};
+
+// A connection of readCircuit() waiting for the end of the AIG section:
+// the fanin literal of a PO or the two fanin literals of an AIG
+struct CirFixup
+{
+   CirFixup(CirGate* g, unsigned l) : _gate(g), _nLit(1) { _lit[0] = l; }
+   CirFixup(CirGate* g, unsigned l0, unsigned l1) : _gate(g), _nLit(2) {
+      _lit[0] = l0; _lit[1] = l1;
+   }
+   CirGate*  _gate;
+   unsigned  _nLit;
+   unsigned  _lit[2];
+};
+
+// Skip spaces, then read a decimal number from [p, end) and move p past
+// it. Return false if there is no number before the end of the line.
+static bool
+scanUnsigned(const char*& p, const char* end, unsigned& n)
+{
+   while(p<end && (*p==' ' || *p=='	')) ++p;
+   if(p==end || *p<'0' || *p>'9') return false;
+   n = 0;
+   while(p<end && *p>='0' && *p<='9') n = n*10 + unsigned(*p++ - '0');
+   return true;
+}
+
+// Decode one LEB128 number of the binary AIGER AND section: 7 bits per
+// byte, least significant first, the top bit set on all but the last byte
+static bool
+decodeDelta(const char*& p, const char* end, unsigned& x)
+{
+   x = 0;
+   for(unsigned shift=0 ; p<end && shift<32 ; shift+=7){
+      const unsigned char ch = *p++;
+      x |= unsigned(ch & 0x7f) << shift;
+      if((ch & 0x80)==0) return true;
+   }
+   return false;
+}
+
+// Encode x as one LEB128 number of the binary AIGER AND section
+static void
+putDelta(OutBuf& out, unsigned x)
+{
+   while(x & ~0x7fu){
+      out.put(char((x & 0x7f) | 0x80));
+      x >>= 7;
+   }
+   out.put(char(x));
+}
+
+// Move p to the beginning of the next line
+static void
+skipLine(const char*& p, const char* end)
+{
+   const char* nl = (const char*)memchr(p, '\n', end-p);
+   p = (nl==0)? end: nl+1;
+}
+
 static bool
 parseError(CirParseError err)
 {
@@ -151,174 +244,343 @@ parseError(CirParseError err)
 /**************************************************************/
 /*   class CirMgr member functions for circuit construction   */
 /**************************************************************/
+// The file is mapped and scanned once. Gates are created as their lines
+// are met and connected at once when their fanins already exist; the other
+// connections (all POs, AIGs with a fanin defined further down) go to a
+// fixup table resolved after the AIG section, which also creates the UNDEF
+// gates.
+// A binary AIGER file ("aig" header) is read by the same pass: its PIs are
+// implicit and its AIGs are delta-encoded in topological order, so every
+// AIG is connected as soon as it is decoded. Its gates get the line numbers
+// they would have in the aag file.
+// With strash, the AIG lines are only recorded and built by strashAnds()
+// before the POs are connected.
 bool
-CirMgr::readCircuit(const string& fileName)
+CirMgr::readCircuit(const string& fileName, bool strash)
 {
    CirGate::resetGlobalRef();
-   ifstream ifs;
-   istringstream iss;
-   string temp_line = "";
-   string temp_data = "";
-   int temp_int[5];
+   MappedFile file;
+   unsigned temp_int[5];
    CirGate* temp_gate;
 
    //open
-   ifs.open(fileName.c_str());
-   if (!ifs) {
+   if (!file.open(fileName)) {
       cerr << "Cannot open design \"" << fileName << "\"!!" << endl;
       return false;
    }
+   const char* p = file.begin();
+   const char* end = file.end();
+   lineNo = 0;
 
    //SECTION1: read first line, set M I L O A
-   getline(ifs,temp_line,'\n'); 
-   iss = istringstream(temp_line);
-   getline(iss,temp_data,' ');
+   const bool binary = (end-p>=3 && strncmp(p, "aig", 3)==0);
+   if(!binary && (end-p<3 || strncmp(p, "aag", 3)!=0)){
+      errMsg = "aag";
+      return parseError(MISSING_IDENTIFIER);
+   }
+   p += 3;
    for(int i=0 ; i<5 ; ++i){
-      if(!getline(iss,temp_data,' ')) { return false; }
-      if(!myStr2Int(temp_data, temp_int[i])){ return false; }
+      if(!scanUnsigned(p, end, temp_int[i])){
+         errMsg = "number of variables";
+         return parseError(MISSING_NUM);
+      }
    }
+   skipLine(p, end);
    _Max = temp_int[0];
    _Pi = temp_int[1];
    _Latch = temp_int[2];
    _Po = temp_int[3];
    _Andgate = temp_int[4];
+   const unsigned maxLit = 2*_Max+1;
+   if(binary && temp_int[0]!=temp_int[1]+temp_int[2]+temp_int[4]){
+      errMsg = "Number of variables";
+      errInt = temp_int[0];
+      if(temp_int[0]<temp_int[1]+temp_int[2]+temp_int[4]) return parseError(NUM_TOO_SMALL);
+      return parseError(NUM_TOO_BIG);
+   }
 
    //set totalList length
-   _totalList.resize(_Max+_Po+1,0);;
+   _totalList.resize(_Max+_Po+1,0);
+   _piList.reserve(_Pi);
 
    //const 0 gate
-   temp_gate = new ConstGate(0, 0);
+   temp_gate = _arena.create<ConstGate>(0, 0);
    _totalList[0] = temp_gate;
 
    //SECTION2: creat PI
-   int line=1;
    for(int i =0 ; i<_Pi ; ++i){
-      getline(ifs,temp_line,'\n');
-      line++;
-      myStr2Int(temp_line, temp_int[0]);
-      temp_gate = new PiGate(temp_int[0]/2, line);
+      ++lineNo;
+      if(binary){
+         temp_gate = _arena.create<PiGate>(i+1, lineNo+1);
+         _totalList[i+1] = temp_gate;
+         _piList.push_back(temp_gate);
+         continue;
+      }
+      if(!scanUnsigned(p, end, temp_int[0])){
+         errMsg = "PI literal ID";
+         return parseError(MISSING_NUM);
+      }
+      if(temp_int[0]>maxLit){
+         errInt = temp_int[0];
+         return parseError(MAX_LIT_ID);
+      }
+      skipLine(p, end);
+      temp_gate = _arena.create<PiGate>(temp_int[0]/2, lineNo+1);
       _totalList[temp_int[0]/2] = temp_gate;
       _piList.push_back(temp_gate);
    }
 
-   //SECTION3: creat PO
+   //Latches are not supported; only skip their lines in a binary file
+   if(binary){
+      for(int i=0 ; i<_Latch ; ++i){ skipLine(p, end); }
+   }
+
+   //SECTION3: creat PO, connected by the fixup table
+   vector<CirFixup> fixup;
+   fixup.reserve(_Po);
    for(int i =0 ; i<_Po ; ++i){
-      getline(ifs,temp_line,'\n');
-      line++;
-      temp_gate = new PoGate(_Max+i+1, line);
+      ++lineNo;
+      if(!scanUnsigned(p, end, temp_int[0])){
+         errMsg = "PO literal ID";
+         return parseError(MISSING_NUM);
+      }
+      if(temp_int[0]>maxLit){
+         errInt = temp_int[0];
+         return parseError(MAX_LIT_ID);
+      }
+      skipLine(p, end);
+      temp_gate = _arena.create<PoGate>(_Max+i+1, lineNo+1);
       _totalList[_Max+i+1] = temp_gate;
+      fixup.push_back(CirFixup(temp_gate, temp_int[0]));
    }
 
-   //SECTION4: creat AIG
-   while( getline(ifs,temp_line,'\n') ){
-      line++;
-      if(temp_line=="c") break; // Next SECTION
-      iss = istringstream(temp_line);
-      int i=0;
-      getline(iss,temp_data,' ');
-      if(!myStr2Int(temp_data, temp_int[i])) break; // Next SECTION
-      i++;
-      while(getline(iss,temp_data,' ')){ myStr2Int(temp_data, temp_int[i]); i++; }
-      temp_gate = new AigGate(temp_int[0]/2, line);
-      _totalList[temp_int[0]/2] = temp_gate;
+   //SECTION4 (strash): fanin literals and line of every AIG, by variable
+   vector<unsigned> andLit, andLine;
+   if(strash){
+      andLit.assign(2*(_Max+1), 0);
+      andLine.assign(_Max+1, 0);
    }
 
-   //SECTION3+: connect po
-   ifs.close();
-   ifs.open(fileName.c_str());//Open file again
-   for(int i=0 ; i<_Pi+1 ; ++i){ getline(ifs,temp_line,'\n'); }
-   for(int i=0 ; i<_Po ; ++i){ 
-      getline(ifs,temp_line,'\n'); 
-      myStr2Int(temp_line, temp_int[0]);
-      if(_totalList[temp_int[0]/2]==0){ // if the fanin gate not exist, creat a UNDEF gate
-         temp_gate = new UndefGate(temp_int[0]/2, 0);
-         _totalList[temp_int[0]/2] = temp_gate;
+   //SECTION4 (binary): lhs is implicit, the fanins are lhs-delta0 and
+   //lhs-delta0-delta1, both below lhs
+   for(int i=0 ; binary && i<_Andgate ; ++i){
+      ++lineNo;
+      const unsigned lhs = 2*(_Pi+_Latch+i+1);
+      unsigned delta0, delta1;
+      if(!decodeDelta(p, end, delta0) || !decodeDelta(p, end, delta1)){
+         errMsg = "AIG delta";
+         return parseError(MISSING_NUM);
       }
-      temp_gate = _totalList[_Max+i+1];
-      temp_gate->addfanin(_totalList[temp_int[0]/2], temp_int[0]%2);
-      _totalList[temp_int[0]/2]->addfanout(temp_gate, temp_int[0]%2); 
-   }
-
-   //SECTION4+: connect AIG
-   while( getline(ifs,temp_line,'\n') ){
-      if(temp_line=="c"){ break; }  // End readCircuit
-      iss = istringstream(temp_line);
-      int i=0;
-      getline(iss,temp_data,' ');
-      if(!myStr2Int(temp_data, temp_int[i])) break; // Next SECTION
-      i++;
-      while(getline(iss,temp_data,' ')){ myStr2Int(temp_data, temp_int[i]); i++; }
-      for(int i=1 ; i<=2 ; i++){  // for two fanin
-         if(_totalList[temp_int[i]/2]==0){  // If the fanin gate not exist
-            temp_gate = new UndefGate(temp_int[i]/2, 0);
-            _totalList[temp_int[i]/2] = temp_gate;
-         }
-         temp_gate = _totalList[temp_int[0]/2];
-         temp_gate->addfanin(_totalList[temp_int[i]/2], temp_int[i]%2);
-         _totalList[temp_int[i]/2]->addfanout(temp_gate, temp_int[i]%2);
+      if(delta0==0 || delta0>lhs || delta1>lhs-delta0){
+         errMsg = "AIG delta";
+         return parseError(ILLEGAL_NUM);
+      }
+      if(strash){
+         andLit[lhs] = lhs-delta0;
+         andLit[lhs+1] = lhs-delta0-delta1;
+         andLine[lhs/2] = lineNo+1;
+         continue;
       }
+      temp_gate = _arena.create<AigGate>(lhs/2, lineNo+1);
+      _totalList[lhs/2] = temp_gate;
+      connectFanin(temp_gate, lhs-delta0);
+      connectFanin(temp_gate, lhs-delta0-delta1);
    }
 
-   //SECTION5: Set PI PO name
-   do{
-      if(temp_line=="c"){ break; }// End readCircuit
-      iss = istringstream(temp_line);
-      getline(iss,temp_data,' '); //get pi po number
-      if(temp_data[0]=='i'){
-         temp_data.erase(temp_data.begin());
-         myStr2Int(temp_data, temp_int[0]);
-         temp_line.erase(0,temp_data.size()+2);
-         _piList[temp_int[0]]->addName(temp_line);
+   //SECTION4: creat AIG and connect the ones whose fanins exist
+   while(!binary && p<end && *p>='0' && *p<='9'){
+      ++lineNo;
+      for(int i=0 ; i<3 ; ++i){
+         if(!scanUnsigned(p, end, temp_int[i])){
+            errMsg = "AIG literal ID";
+            return parseError(MISSING_NUM);
+         }
+         if(temp_int[i]>maxLit){
+            errInt = temp_int[i];
+            return parseError(MAX_LIT_ID);
+         }
+      }
+      skipLine(p, end);
+      if(strash){
+         andLit[temp_int[0]&~1u] = temp_int[1];
+         andLit[temp_int[0]|1u] = temp_int[2];
+         andLine[temp_int[0]/2] = lineNo+1;
+         continue;
       }
-      else if(temp_data[0]=='o'){
-         temp_data.erase(temp_data.begin());
-         myStr2Int(temp_data, temp_int[0]);
-         temp_line.erase(0,temp_data.size()+2);
-         _totalList[_Max+1+temp_int[0]]->addName(temp_line);
+      temp_gate = _arena.create<AigGate>(temp_int[0]/2, lineNo+1);
+      _totalList[temp_int[0]/2] = temp_gate;
+      if(_totalList[temp_int[1]/2]!=0 && _totalList[temp_int[2]/2]!=0){
+         connectFanin(temp_gate, temp_int[1]);
+         connectFanin(temp_gate, temp_int[2]);
       }
-   }while(getline(ifs,temp_line,'\n'));
+      else fixup.push_back(CirFixup(temp_gate, temp_int[1], temp_int[2]));
+   }
 
-   //Sort every gate
-   for(int i=0 ; i<_Max+1 ; ++i){
-      if(_totalList[i]!=0) _totalList[i]->sortFanout();
+   //SECTION3+4: resolve the fixup table; missing fanins become UNDEF
+   vector<unsigned> litMap;
+   if(strash && !strashAnds(andLit, andLine, litMap)) return false;
+   for(size_t i=0 ; i<fixup.size() ; ++i){
+      for(unsigned j=0 ; j<fixup[i]._nLit ; ++j){
+         const unsigned lit = fixup[i]._lit[j];
+         connectFanin(fixup[i]._gate, strash? (litMap[lit/2] ^ (lit&1)): lit);
+      }
+   }
+
+   //SECTION5: Set PI PO name
+   while(p<end && *p!='c'){
+      const char type = *p++;
+      if((type=='i' || type=='o') && scanUnsigned(p, end, temp_int[0])){
+         if(p<end && *p==' ') ++p;
+         const char* name = p;
+         while(p<end && *p!='\n') ++p;
+         if(type=='i' && temp_int[0]<unsigned(_Pi))
+            _piList[temp_int[0]]->addName(string(name, p), _arena);
+         else if(type=='o' && temp_int[0]<unsigned(_Po))
+            _totalList[_Max+1+temp_int[0]]->addName(string(name, p), _arena);
+      }
+      skipLine(p, end);
    }
 
    dfsTraversal();
-   findFltInandNotUse();
    return true;
 }
 
-void 
-CirMgr::findFltInandNotUse()
+// Connect literal lit as the next fanin of g, creating an UNDEF gate for a
+// variable that was never defined
+void
+CirMgr::connectFanin(CirGate* g, unsigned lit)
 {
-   //PI : NotUse
-   for(int i=1 ; i<=_Pi ; ++i){
-      if(_totalList[i]!=0){
-         if(_totalList[i]->fanoutNum()==0)
-            _notusedList.push_back(_totalList[i]);
-      }
+   if(_totalList[lit/2]==0){
+      _totalList[lit/2] = _arena.create<UndefGate>(lit/2, 0);
    }
-   //AIG : Floating Input & Not Use
-   for(int i=_Pi+1 ; i<=_Max ; ++i){
-      if(_totalList[i]!=0){
-         if(_totalList[i]->fanoutNum()==0){ _notusedList.push_back(_totalList[i]); }
-         for(int j=0 ; j<_totalList[i]->faninNum() ; ++j){
-            if(_totalList[i]->getfanin(j)->getTypeStr()=="UNDEF"){
-               _flfaninList.push_back(_totalList[i]);
-               break;
+   g->addfanin(_totalList[lit/2], lit%2, _arena);
+   _fanoutReady = false;
+}
+
+// Build the AIGs recorded by a strash read (fanins andLit[2v], andLit[2v+1];
+// variable v is an AIG when andLine[v]!=0) in topological order. Each AIG
+// is first simplified like optimize() and then looked up by its fanin pair
+// in a hash table like strash(), so only the ones left become gates.
+// litMap[v] is set to the literal that replaces variable v.
+bool
+CirMgr::strashAnds(const vector<unsigned>& andLit, const vector<unsigned>& andLine,
+                   vector<unsigned>& litMap)
+{
+   const unsigned maxVar = _Max;
+   litMap.resize(maxVar+1);
+   for(unsigned v=0 ; v<=maxVar ; ++v){ litMap[v] = 2*v; }
+   vector<unsigned char> state(maxVar+1, 0);   // 1: on the DFS path, 2: built
+   HashMap<faninKey, CirGate*> hashMap(_Andgate+1);
+   vector<unsigned> stack;
+   int built = 0;
+   for(unsigned v=1 ; v<=maxVar ; ++v){
+      if(andLine[v]==0 || state[v]!=0) continue;
+      stack.push_back(v);
+      while(!stack.empty()){
+         const unsigned u = stack.back();
+         if(state[u]==0){
+            state[u] = 1;
+            for(int j=0 ; j<2 ; ++j){
+               const unsigned f = andLit[2*u+j]/2;
+               if(andLine[f]==0 || state[f]==2) continue;
+               if(state[f]==1){
+                  cerr << "[ERROR] Line " << andLine[u] << ": AIG " << 2*u
+                       << " is in a combinational loop!!" << endl;
+                  return false;
+               }
+               if(j==0 || f!=andLit[2*u]/2) stack.push_back(f);
             }
+            continue;
+         }
+         stack.pop_back();
+         if(state[u]==2) continue;
+         state[u] = 2;
+         unsigned a = litMap[andLit[2*u]/2] ^ (andLit[2*u]&1);
+         unsigned b = litMap[andLit[2*u+1]/2] ^ (andLit[2*u+1]&1);
+         if(a>b) swap(a, b);
+         if(a==0 || a==(b^1)) litMap[u] = 0;      // CONST 0 or x & !x
+         else if(a==1 || a==b) litMap[u] = b;     // CONST 1 or x & x
+         else{
+            CirGate* gate;
+            if(hashMap.query(faninKey(a, b), gate)){ litMap[u] = 2*gate->getId(); continue; }
+            gate = _arena.create<AigGate>(u, andLine[u]);
+            _totalList[u] = gate;
+            connectFanin(gate, a);
+            connectFanin(gate, b);
+            hashMap.insert(faninKey(a, b), gate);
+            ++built;
          }
       }
    }
-   //PO : Floating Input
-   for(int i=_Max+1 ; i<_totalList.size() ; ++i){
-      if(_totalList[i]!=0){
-         for(int j=0 ; j<_totalList[i]->faninNum() ; ++j){
-            if(_totalList[i]->getfanin(j)->getTypeStr()=="UNDEF"){
-               _flfaninList.push_back(_totalList[i]);
-               break;
-            }
-         }
+   _Andgate = built;
+   return true;
+}
+
+// Move every fanout of dgate to mgate, inverted when inv, in O(1): dgate
+// is linked to mgate and the fanins that still name dgate are resolved
+// when read. They are stored resolved, and the fanout index rebuilt, the
+// next time the index is needed.
+// The DFS list is patched in place: mgate takes over the DFS fanouts of
+// dgate, and dgate leaves the DFS with the part of its cone that nothing
+// else in the DFS uses.
+void
+CirMgr::moveFanouts(CirGate* dgate, CirGate* mgate, bool inv)
+{
+   const GateV m = CirGate::resolve(GateV(mgate, inv));
+   mgate = m.gate();
+   dgate->setRepl(m);
+   _fanoutReady = false;
+   const unsigned ref = dgate->dfsRef();
+   if(ref!=0){
+      if(mgate->isindfs()) mgate->setDfsRef(mgate->dfsRef()+ref);
+      else{ mgate->setDfsRef(ref); reviveDfs(mgate); }
+   }
+   if(dgate->isindfs()) killDfs(dgate);
+}
+
+// Rebuild the fanout index from the fanins of the gates in one counting
+// pass and one filling pass. The fanins of merged gates are replaced by
+// the gates they resolve to on the way.
+void
+CirMgr::buildFanout() const
+{
+   const size_t n = _totalList.size();
+   _fanoutBegin.assign(n+1, 0);
+   for(size_t i=0 ; i<n ; ++i){
+      if(_totalList[i]==0) continue;
+      _totalList[i]->resolveFanins();
+      for(size_t j=0, m=_totalList[i]->faninNum() ; j<m ; ++j){
+         ++_fanoutBegin[_totalList[i]->getfanin(j)->getId()+1];
+      }
+   }
+   for(size_t i=0 ; i<n ; ++i){ _fanoutBegin[i+1] += _fanoutBegin[i]; }
+   // Fill with _fanoutBegin[id] as the cursor of id, then shift it back
+   _fanoutEdge.assign(_fanoutBegin[n], GateV(0, 0));
+   for(size_t i=0 ; i<n ; ++i){
+      if(_totalList[i]==0) continue;
+      for(size_t j=0, m=_totalList[i]->faninNum() ; j<m ; ++j){
+         unsigned id = _totalList[i]->getfanin(j)->getId();
+         _fanoutEdge[_fanoutBegin[id]++] = GateV(_totalList[i], _totalList[i]->faninIsInv(j));
+      }
+   }
+   for(size_t i=n ; i>0 ; --i){ _fanoutBegin[i] = _fanoutBegin[i-1]; }
+   _fanoutBegin[0] = 0;
+   for(size_t i=0 ; i<n ; ++i){
+      if(_totalList[i]==0) continue;
+      _totalList[i]->setFanout(_fanoutEdge.data()+_fanoutBegin[i], _fanoutBegin[i+1]-_fanoutBegin[i]);
+   }
+   _fanoutReady = true;
+
+   _flfaninList.clear();
+   _notusedList.clear();
+   for(size_t i=1 ; i<n ; ++i){
+      CirGate* g = _totalList[i];
+      if(g==0) continue;
+      //PI, AIG : Not Use
+      if(i<=size_t(_Max) && !g->isUndef() && g->fanoutNum()==0) _notusedList.push_back(g);
+      //AIG, PO : Floating Input
+      for(size_t j=0, m=g->faninNum() ; j<m ; ++j){
+         if(g->getfanin(j)->isUndef()){ _flfaninList.push_back(g); break; }
       }
    }
 }
@@ -350,10 +612,14 @@ CirMgr::printSummary() const
 void
 CirMgr::printNetlist() const
 {
+   // A fresh DFS, since _dfsList is only patched after merges
+   vector<CirGate *> list;
+   CirGate::setGlobalRef();
+   if(_Po!=0) CirGate::dfsTraversal(&_totalList[_Max+1], _Po, list);
    cout<<endl;
-   for(int i=0 ; i<_dfsList.size() ; ++i){
+   for(int i=0 ; i<list.size() ; ++i){
       cout<<"["<<i<<"] ";
-      _dfsList[i]->printGate();
+      list[i]->printGate();
    }
 }
 
@@ -380,6 +646,7 @@ CirMgr::printPOs() const
 void
 CirMgr::printFloatGates() const
 {
+   updateFanout();
    if(!_flfaninList.empty()){
       cout<<"Gates with floating fanin(s):";
       for(int i=0 ; i<_flfaninList.size() ; ++i){
@@ -399,95 +666,113 @@ CirMgr::printFloatGates() const
 void
 CirMgr::printFECPairs() const
 {
-   for(size_t i=0 ; i<_FECGrps.size() ; ++i){
-      size_t firstValue = _totalList[_FECGrps[i][0]]->getValue();
+   for(size_t i=0 ; i<fecGrpNum() ; ++i){
+      size_t firstValue = _totalList[_fecGate[_fecBegin[i]]]->getValue();
       cout<<"["<<i<<"]";
-      for(size_t j=0 ; j<_FECGrps[i].size() ; ++j){
+      for(size_t j=_fecBegin[i] ; j<_fecBegin[i+1] ; ++j){
          cout<<" ";
-         if(_totalList[_FECGrps[i][j]]->getValue() != firstValue) cout<<"!";
-         cout<<_FECGrps[i][j];
+         if(_totalList[_fecGate[j]]->getValue() != firstValue) cout<<"!";
+         cout<<_fecGate[j];
       }
       cout<<endl;
    }
 }
 
 void
-CirMgr::writeAag(ostream& outfile) const
+CirMgr::writeAag(ostream& outfile, bool binary) const
 {
-   int _NewAIG=0;
-   vector<int> NewAIGList;
-   for(int i=0 ; i<_dfsList.size() ; ++i){
-      if(_dfsList[i]->getTypeStr()=="AIG"){
-         _NewAIG++;
-         NewAIGList.push_back(_dfsList[i]->getId());
-      }
-   }
-   outfile<<"aag "<<_Max<<" "<<_Pi<<" "<<_Latch<<" "<<_Po<<" "<<_NewAIG<<endl;
-   for(int i=0 ; i<_Pi ; ++i){ outfile<<(_piList[i]->getId())*2<<endl; }
-   for(int i=_Max+1 ; i<=_Max+_Po ; ++i){ 
-      if(_totalList[i]->faninIsInv(0)){ outfile<<(_totalList[i]->getfanin(0)->getId())*2+1<<endl; }
-      else{ outfile<<(_totalList[i]->getfanin(0)->getId())*2<<endl; }
-   }
-   CirGate* now_gate;
-   for(int i=0 ; i<NewAIGList.size() ; ++i){
-      now_gate = _totalList[NewAIGList[i]];
-      outfile<<(now_gate->getId())*2;
-      for(int i=0 ; i<2 ; ++i){
-         if(now_gate->faninIsInv(i)){ outfile<<" "<<(now_gate->getfanin(i)->getId())*2+1; }
-         else{ outfile<<" "<<(now_gate->getfanin(i)->getId())*2; }
-      }
-      outfile<<endl;
-   }
-   for(int i=0 ; i<_Pi ; ++i){ 
-      if(_piList[i]->haveName()) 
-         outfile<<"i"<<i<<" "<<_piList[i]->getName()<<endl; 
+   vector<CirGate *> list, aigList;
+   CirGate::setGlobalRef();
+   if(_Po!=0) CirGate::dfsTraversal(&_totalList[_Max+1], _Po, list);
+   for(size_t i=0 ; i<list.size() ; ++i){
+      if(list[i]->isAig()) aigList.push_back(list[i]);
    }
-   for(int i=_Max+1 ; i<=_Max+_Po ; ++i){ 
-      if(_totalList[i]->haveName()) 
-         outfile<<"o"<<i<<" "<<_totalList[i]->getName()<<endl; 
+   vector<unsigned> poLit;
+   vector<string> poName;
+   for(int i=_Max+1 ; i<=_Max+_Po ; ++i){
+      poLit.push_back(_totalList[i]->getfanin(0)->getId()*2 + (_totalList[i]->faninIsInv(0)? 1: 0));
+      poName.push_back(_totalList[i]->getName());
    }
+   writeAiger(outfile, aigList, poLit, poName, binary);
 }
 
 void
-CirMgr::writeGate(ostream& outfile, CirGate *g) const
+CirMgr::writeGate(ostream& outfile, CirGate *g, bool binary) const
 {
    vector<CirGate *> _List;
    CirGate::setGlobalRef();
    g->dfsTraversal(_List);
 
-   int _NewAIG=0;
-   vector<int> NewAIGList;
-   for(int i=0 ; i<_List.size() ; ++i){
-      if(_List[i]->getTypeStr()=="AIG"){
-         _NewAIG++;
-         NewAIGList.push_back(_List[i]->getId());
+   vector<CirGate *> aigList;
+   for(size_t i=0 ; i<_List.size() ; ++i){
+      if(_List[i]->isAig()) aigList.push_back(_List[i]);
+   }
+   vector<unsigned> poLit(1, g->getId()*2);
+   vector<string> poName(1, to_string(g->getId()));
+   writeAiger(outfile, aigList, poLit, poName, binary);
+}
+
+// Write all the PIs, the AIGs of aigList (in topological order) and POs
+// driven by the literals of poLit; PO i is named poName[i] if not empty.
+// The ASCII format keeps the gate ids. The binary format renumbers PI k to
+// k+1 and the AIGs from _Pi+1 in the order of aigList; UNDEF gates become
+// CONST 0, the value simulation gives them. Everything is formatted in an
+// OutBuf, so the stream is written in large blocks and never flushed.
+void
+CirMgr::writeAiger(ostream& outfile, const vector<CirGate *>& aigList,
+                   const vector<unsigned>& poLit, const vector<string>& poName,
+                   bool binary) const
+{
+   OutBuf out(outfile);
+   vector<unsigned> varOf;
+   if(binary){
+      varOf.assign(_totalList.size(), 0);
+      for(int i=0 ; i<_Pi ; ++i){ varOf[_piList[i]->getId()] = i+1; }
+      for(size_t i=0 ; i<aigList.size() ; ++i){ varOf[aigList[i]->getId()] = _Pi+1+i; }
+      out<<"aig "<<unsigned(_Pi+aigList.size())<<' '<<_Pi<<" 0 "<<unsigned(poLit.size())
+         <<' '<<unsigned(aigList.size())<<'\n';
+      for(size_t i=0 ; i<poLit.size() ; ++i){
+         out<<(varOf[poLit[i]/2]*2 + poLit[i]%2)<<'\n';
+      }
+      for(size_t i=0 ; i<aigList.size() ; ++i){
+         const unsigned lhs = 2*(_Pi+1+i);
+         unsigned rhs[2];
+         for(int j=0 ; j<2 ; ++j){
+            rhs[j] = varOf[aigList[i]->getfanin(j)->getId()]*2 + (aigList[i]->faninIsInv(j)? 1: 0);
+         }
+         if(rhs[0]<rhs[1]) swap(rhs[0], rhs[1]);
+         putDelta(out, lhs-rhs[0]);
+         putDelta(out, rhs[0]-rhs[1]);
       }
    }
-   outfile<<"aag "<<_Max<<" "<<_Pi<<" "<<_Latch<<" "<<1<<" "<<_NewAIG<<endl;
-   for(int i=0 ; i<_Pi ; ++i){ outfile<<(_piList[i]->getId())*2<<endl; }
-   outfile<<g->getId()*2<<endl;
-   CirGate* now_gate;
-   for(int i=0 ; i<NewAIGList.size() ; ++i){
-      now_gate = _totalList[NewAIGList[i]];
-      outfile<<(now_gate->getId())*2;
-      for(int i=0 ; i<2 ; ++i){
-         if(now_gate->faninIsInv(i)){ outfile<<" "<<(now_gate->getfanin(i)->getId())*2+1; }
-         else{ outfile<<" "<<(now_gate->getfanin(i)->getId())*2; }
+   else{
+      out<<"aag "<<_Max<<' '<<_Pi<<' '<<_Latch<<' '<<unsigned(poLit.size())<<' '
+         <<unsigned(aigList.size())<<'\n';
+      for(int i=0 ; i<_Pi ; ++i){ out<<(_piList[i]->getId())*2<<'\n'; }
+      for(size_t i=0 ; i<poLit.size() ; ++i){ out<<poLit[i]<<'\n'; }
+      for(size_t i=0 ; i<aigList.size() ; ++i){
+         out<<(aigList[i]->getId())*2;
+         for(int j=0 ; j<2 ; ++j){
+            out<<' '<<(aigList[i]->getfanin(j)->getId()*2 + (aigList[i]->faninIsInv(j)? 1: 0));
+         }
+         out<<'\n';
       }
-      outfile<<endl;
    }
    for(int i=0 ; i<_Pi ; ++i){ 
       if(_piList[i]->haveName()) 
-         outfile<<"i"<<i<<" "<<_piList[i]->getName()<<endl; 
+         out<<'i'<<i<<' '<<_piList[i]->getName()<<'\n'; 
+   }
+   for(size_t i=0 ; i<poName.size() ; ++i){ 
+      if(poName[i]!="") 
+         out<<'o'<<unsigned(i)<<' '<<poName[i]<<'\n'; 
    }
-   outfile<<"o"<<0<<" "<<g->getId()<<endl; 
 }
 
 vector<unsigned>
 CirMgr::sendGrp(size_t i)
 {
-   if(i>=_FECGrps.size()) { vector<unsigned> a; return a; }
-   return _FECGrps[i];
+   if(i>=fecGrpNum()) { vector<unsigned> a; return a; }
+   return vector<unsigned>(_fecGate.begin()+_fecBegin[i], _fecGate.begin()+_fecBegin[i+1]);
 }
 
 
@@ -496,13 +781,145 @@ CirMgr::sendGrp(size_t i)
 /*   class CirMgr member functions for circuit DFS        */
 /**********************************************************/
 
+// Rebuild _dfsList from the POs and count the DFS fanouts of every gate.
+// Passes keep it up to date afterwards with moveFanouts() and updateDfs().
 void 
 CirMgr::dfsTraversal()
 {
    _dfsList.clear();
+   releaseAig();
+   for(size_t i=0 ; i<_totalList.size() ; ++i){
+      if(_totalList[i]==0) continue;
+      _totalList[i]->setInDfs(false);
+      _totalList[i]->setDfsRef(0);
+   }
    CirGate::setGlobalRef();
-   for(int i=_Max+1 ; i<=_Max+_Po ; ++i){
-      _totalList[i]->dfsTraversal(_dfsList);
+   if(_Po!=0) CirGate::dfsTraversal(&_totalList[_Max+1], _Po, _dfsList);
+   _dfsHasConst = false;
+   for(size_t i=0 ; i<_dfsList.size() ; ++i){
+      CirGate* g = _dfsList[i];
+      g->setInDfs(true);
+      if(g==_totalList[0]) _dfsHasConst = true;
+      for(size_t j=0, n=g->faninNum() ; j<n ; ++j){
+         g->getfanin(j)->setInDfs(true);
+         g->getfanin(j)->incDfsRef();
+      }
+   }
+   _dfsDead = 0;
+   _dfsCompact = false;
+}
+
+// Take g out of the DFS, then every fanin left without DFS fanouts, i.e.
+// the MFFC of g. Their entries in _dfsList stay behind as holes.
+void
+CirMgr::killDfs(CirGate* g)
+{
+   g->setInDfs(false);
+   g->setDfsRef(0);
+   _dfsStack.assign(1, g);
+   while(!_dfsStack.empty()){
+      CirGate* x = _dfsStack.back();
+      _dfsStack.pop_back();
+      if(!x->isUndef()) ++_dfsDead;
+      for(size_t i=0, n=x->faninNum() ; i<n ; ++i){
+         CirGate* fanin = x->getfanin(i);
+         if(fanin->decDfsRef()==0){
+            fanin->setInDfs(false);
+            _dfsStack.push_back(fanin);
+         }
+      }
    }
 }
 
+// Bring g back into the DFS with the part of its cone that had left. A
+// merge only revives a gate listed before the merged one (or CONST 0), so
+// their old entries are still in topological order; CONST 0 may have no
+// entry, then compactDfs() puts it first.
+void
+CirMgr::reviveDfs(CirGate* g)
+{
+   g->setInDfs(true);
+   _dfsStack.assign(1, g);
+   while(!_dfsStack.empty()){
+      CirGate* x = _dfsStack.back();
+      _dfsStack.pop_back();
+      if(x==_totalList[0] && !_dfsHasConst) _dfsCompact = true;
+      else if(!x->isUndef() && _dfsDead!=0) --_dfsDead;
+      for(size_t i=0, n=x->faninNum() ; i<n ; ++i){
+         CirGate* fanin = x->getfanin(i);
+         if(fanin->incDfsRef()==0){
+            fanin->setInDfs(true);
+            _dfsStack.push_back(fanin);
+         }
+      }
+   }
+}
+
+// Called at the end of every pass that merges gates, instead of a full
+// dfsTraversal()
+void
+CirMgr::updateDfs()
+{
+   releaseAig();
+   if(_dfsCompact || 2*_dfsDead>_dfsList.size()) compactDfs();
+}
+
+// Drop the holes of _dfsList and recompute the levels
+void
+CirMgr::compactDfs()
+{
+   size_t n = 0;
+   if(_dfsCompact){
+      _dfsList.insert(_dfsList.begin(), _totalList[0]);
+      _dfsHasConst = true;
+   }
+   for(size_t i=0 ; i<_dfsList.size() ; ++i){
+      CirGate* g = dfsGate(i);
+      if(g!=0) _dfsList[n++] = g;
+   }
+   _dfsList.resize(n);
+   for(size_t i=0 ; i<n ; ++i){ _dfsList[i]->updateLevel(); }
+   _dfsHasConst = _totalList[0]->isindfs();
+   _dfsDead = 0;
+   _dfsCompact = false;
+}
+
+// Take the snapshot _aig of the CirGates. The AND order follows _dfsList
+// without its holes.
+void
+CirMgr::buildAig()
+{
+   _aig.reset(_totalList.size());
+   for(size_t i=0 ; i<_totalList.size() ; ++i){
+      CirGate* g = _totalList[i];
+      if(g==0) continue;
+      if(g->isAig()){
+         _aig.setGate(i, AIG_AND, 2*g->getfanin(0)->getId()+g->faninIsInv(0),
+                                  2*g->getfanin(1)->getId()+g->faninIsInv(1));
+         continue;
+      }
+      const string type = g->getTypeStr();
+      if(type=="PO")
+         _aig.setGate(i, AIG_PO, 2*g->getfanin(0)->getId()+g->faninIsInv(0));
+      else if(type=="PI") _aig.setGate(i, AIG_PI);
+      else if(type=="CONST") _aig.setGate(i, AIG_CONST);
+      else _aig.setGate(i, AIG_UNDEF);
+   }
+   for(size_t i=0 ; i<_dfsList.size() ; ++i){
+      CirGate* g = dfsGate(i);
+      if(g==0 || !g->isAig()) continue;
+      _aig.addOrder(g->getId());
+   }
+   _aigReady = true;
+}
+
+// Drop the snapshot and the simulation values computed on it after the
+// netlist changes; the next simulateWords() takes a new one.
+void
+CirMgr::releaseAig()
+{
+   _aig.release();
+   vector<size_t>().swap(_simValue);
+   _aigReady = false;
+}
+
@@ -21,6 +21,10 @@ using namespace std;
 #define SIZE_T  (8*sizeof(size_t))
 
 #include "cirDef.h"
+#include "cirGate.h"
+#include "cirAig.h"
+#include "myArena.h"
+#include "rnGen.h"
 
 extern CirMgr *cirMgr;
 
@@ -29,22 +33,24 @@ class CirMgr
 typedef  vector<unsigned>  FECGrp;
 
 public:
-   CirMgr() : _Max(0), _Pi(0), _Latch(0), _Po(0), _Andgate(0),_simFirst(true) {}
-   ~CirMgr() {
-      int totelsize = _totalList.size();
-      for(int i=0 ; i<totelsize ; ++i){
-         delete _totalList[i];
-      }
-   } 
+   CirMgr() : _simLog(0), _simFirst(true), _aigReady(false), _fanoutReady(false),
+              _simWords(1), _simBlocks(1), _dfsDead(0), _dfsHasConst(false),
+              _dfsCompact(false), _Max(0), _Pi(0), _Latch(0), _Po(0), _Andgate(0) {}
+   // The gates live in _arena and are released with it
+   ~CirMgr() { setSimLog(0); }
 
    // Access functions
    // return '0' if "gid" corresponds to an undefined gate.
-   CirGate* getGate(unsigned gid) const { if(gid<=_Max+_Po){ return _totalList[gid]; } return 0; } 
+   CirGate* getGate(unsigned gid) const { if(gid<=_Max+_Po){ updateFanout(); return _totalList[gid]; } return 0; } 
 
    // Member functions about circuit construction
-   bool readCircuit(const string&);
-   void findFltInandNotUse();
-   void clearFltInandNotUse(){_flfaninList.clear();_notusedList.clear();}
+   bool readCircuit(const string&, bool strash = false);
+   bool strashAnds(const vector<unsigned>& andLit, const vector<unsigned>& andLine,
+                   vector<unsigned>& litMap);
+   void connectFanin(CirGate* g, unsigned lit);
+   void moveFanouts(CirGate* dgate, CirGate* mgate, bool inv);
+   void updateFanout() const { if(!_fanoutReady) buildFanout(); }
+   void buildFanout() const;
 
    // Member functions about circuit optimization
    void sweep();
@@ -52,23 +58,36 @@ public:
    void opt_merge(CirGate * mgate, CirGate * newgate, bool inv);
 
    // Member functions about simulation
-   void randomSim();
+   void randomSim(unsigned nWords = 1, unsigned nThreads = 1);
+   void setSimSeed(size_t seed) { _simGen.seed(seed); }
    void fileSim(ifstream&);
-   void setSimLog(ofstream *logFile) { _simLog = logFile; }
+   void fileSim(const CirPatternMap&);
+   bool convertPatterns(ifstream&, ofstream&);
+   void setSimLog(ofstream *logFile, bool raw = false);
    void simulate(bitset<SIZE_T> ParalPattern[]);
+   void simulateWords(const size_t* pattern, unsigned nWords, unsigned nBlocks = 1,
+                      SimWorkers* workers = 0);
+   void loadSimWord(unsigned w, unsigned b = 0);
 
    // Member functions about FEC group
    void initFECGrps();
    void splitFECGrps();
    void sortAndRecord();
-   static bool sortFECGrp(FECGrp i,FECGrp j){ return (i[0]<j[0]); }
-   void writeLogFile(size_t num, bitset<SIZE_T> ParalPattern[]);
+   size_t fecGrpNum() const { return _fecBegin.empty()? 0: _fecBegin.size()-1; }
+   void writeLogFile(size_t num, const size_t* pi);
 
    // Member functions about fraig
    void strash();
    void str_merge(CirGate * dgate, CirGate * mgate);
    void printFEC() const;
-   void fraig();
+   void fraig(int conflictLimit = -1, int nThreads = 1);
+   void fraigThreads(int conflictLimit, int nThreads);
+   void fraig_merge(CirGate * dgate, CirGate * mgate, bool inv);
+   void genProofModel(SatSolver& solver);
+   void updateFECGrpsBySat(vector<bitset<SIZE_T> >& cexPattern, size_t nCex);
+   void findFECReps();
+   void purgeFECGrps();
+   size_t fecCandidateNum() const;
 
    // Member functions about circuit reporting
    void printSummary() const;
@@ -77,24 +96,61 @@ public:
    void printPOs() const;
    void printFloatGates()const;
    void printFECPairs() const;
-   void writeAag(ostream&) const;
-   void writeGate(ostream&, CirGate*) const;
+   void writeAag(ostream&, bool binary = false) const;
+   void writeGate(ostream&, CirGate*, bool binary = false) const;
+   void writeAiger(ostream&, const vector<CirGate *>& aigList, const vector<unsigned>& poLit,
+                   const vector<string>& poName, bool binary) const;
    vector<unsigned> sendGrp(size_t i);
 
 
    // Member functions about DFS
    void dfsTraversal();
+   void killDfs(CirGate* g);
+   void reviveDfs(CirGate* g);
+   void updateDfs();
+   void compactDfs();
+   // The gate at position i of _dfsList, or 0 if it has left the DFS
+   CirGate* dfsGate(size_t i) const { return (_dfsList[i]!=0 && _dfsList[i]->isindfs())? _dfsList[i]: 0; }
+   void buildAig();
+   void releaseAig();
 
 private:
-   ofstream          *_simLog;
+   CirSimLog         *_simLog;
 
    bool              _simFirst;
-   vector<FECGrp>    _FECGrps;
+   CirAig            _aig;         // snapshot for simulation and fraig
+   bool              _aigReady;    // false once the netlist changes
+   // Fanout index: the fanouts of gate id are _fanoutEdge[_fanoutBegin[id]]
+   // .. _fanoutEdge[_fanoutBegin[id+1]-1], in increasing id of the fanout
+   mutable vector<unsigned> _fanoutBegin;
+   mutable vector<GateV>    _fanoutEdge;
+   mutable bool             _fanoutReady;   // false after a structural edit
+   // Gates with a floating fanin and gates without fanouts, found together
+   // with the fanout index
+   mutable vector<CirGate *> _flfaninList;
+   mutable vector<CirGate *> _notusedList;
+   RandomWordGen     _simGen;      // random patterns, seed 0 by default
+   unsigned          _simWords;    // words per gate in _simValue (1, 4 or 8)
+   unsigned          _simBlocks;   // pattern blocks in _simValue, one per thread
+   vector<size_t>    _simValue;    // _simWords words per gate id, per block
+   // FEC group i is _fecGate[_fecBegin[i]] .. _fecGate[_fecBegin[i+1]-1];
+   // a gate knows its group index through CirGate::getGrp()
+   vector<unsigned>  _fecGate;
+   vector<size_t>    _fecBegin;
+   vector<size_t>    _fecNewBegin; // scratch of splitFECGrps()
+   Arena             _arena;       // gates, fanin/fanout lists and names
    vector<CirGate *> _totalList;
    vector<CirGate *> _piList;
-   vector<CirGate *> _flfaninList;
-   vector<CirGate *> _notusedList;
+   // Topological order of the gates reachable from the POs. Merges only
+   // take the dead cone out (isindfs() turns false) and leave its entries
+   // as holes until compactDfs().
    vector<CirGate *> _dfsList;
+   size_t            _dfsDead;     // holes in _dfsList
+   bool              _dfsHasConst; // CONST 0 has an entry in _dfsList
+   bool              _dfsCompact;  // CONST 0 came back without an entry
+   vector<CirGate *> _dfsStack;    // scratch of killDfs()/reviveDfs()
+   vector<size_t>    _dfsOrder;   // DFS position of each gate, used by fraig
+   vector<unsigned>  _fecReps;    // representative of each FEC group in fraig
 
    int _Max;
    int _Pi;
@@ -0,0 +1,321 @@
+/****************************************************************************
+  FileName     [ cirPattern.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define simulation pattern and log file I/O ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cirPattern.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+static const char patternMagic[8] = { 'C', 'I', 'R', 'P', 'A', 'T', '1', '\n' };
+static const char logMagic[8] = { 'C', 'I', 'R', 'L', 'O', 'G', '1', '\n' };
+
+// bitChars[b] is b in 0/1 characters, bit 0 first
+static struct BitChars
+{
+   BitChars() {
+      for(unsigned b=0 ; b<256 ; ++b)
+         for(unsigned k=0 ; k<8 ; ++k) _c[b][k] = char('0' + ((b>>k) & 1));
+   }
+   const char* operator [] (size_t b) const { return _c[b]; }
+   char _c[256][8];
+} bitChars;
+
+static inline bool
+isBlank(char c)
+{
+   return (c==' ' || c=='\n' || c=='\r' || c=='\t');
+}
+
+// Pack the n characters of s into bits, s[i] into bit i%64 of words[i/64],
+// and return false if any of them is not '0' or '1'. With SSE2, 16
+// characters are checked and packed at a time.
+static bool
+packBits(const char* s, size_t n, size_t* words)
+{
+   unsigned bad = 0;
+   for(size_t i=0, w=0 ; i<n ; ++w){
+      const size_t m = (n-i<64)? n-i: 64;
+      size_t bits = 0, k = 0;
+#if defined(__SSE2__)
+      const __m128i mask = _mm_set1_epi8(char(0xfe)), zero = _mm_set1_epi8('0');
+      for( ; k+16<=m ; k+=16){
+         const __m128i v = _mm_loadu_si128((const __m128i*)(s+i+k));
+         bad |= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, mask), zero)) ^ 0xffff;
+         bits |= size_t(_mm_movemask_epi8(_mm_slli_epi64(v, 7))) << k;
+      }
+#endif
+      for( ; k<m ; ++k){
+         bad |= ((s[i+k] & ~1) != '0');
+         bits |= size_t(s[i+k] & 1) << k;
+      }
+      words[w] = bits;
+      i += m;
+   }
+   return (bad==0);
+}
+
+// Transpose the 64x64 bit matrix a[]: bit c of a[r] goes to bit r of a[c]
+static void
+transpose64(size_t a[64])
+{
+   size_t m = 0x00000000ffffffffULL;
+   for(unsigned j=32 ; j!=0 ; j>>=1, m^=(m<<j)){
+      for(unsigned k=0 ; k<64 ; k=((k|j)+1)&~j){
+         const size_t t = ((a[k]>>j) ^ a[k|j]) & m;
+         a[k] ^= t<<j;
+         a[k|j] ^= t;
+      }
+   }
+}
+
+/***********************************************/
+/*   class CirPatternReader member functions   */
+/***********************************************/
+CirPatternReader::CirPatternReader(istream& is, size_t nPi)
+   : _is(is), _nPi(nPi), _nWords((nPi+63)/64), _buf(1 << 20),
+     _begin(0), _end(0), _eof(false), _fail(false), _rows(64*_nWords)
+{
+}
+
+size_t
+CirPatternReader::read(size_t* words)
+{
+   size_t num = 0;
+   while(num<64 && !_fail){
+      if(!nextToken(0, 0)) break;
+      size_t* row = _rows.empty()? 0: &_rows[num*_nWords];
+      // Most patterns end right after nPi characters, and packBits() then
+      // checks that none of them is a blank
+      if(_begin+_nPi<_end && isBlank(_buf[_begin+_nPi]) && packBits(&_buf[_begin], _nPi, row)){
+         _begin += _nPi;
+         ++num;
+         continue;
+      }
+      const char* tok;
+      size_t len;
+      nextToken(&tok, &len);
+      const string pat(tok, len);
+      if(len!=_nPi){
+         cerr << "Error: Pattern(" << pat << ") length(" << len
+              << ") does not match the number of inputs(" << _nPi << ") in a circuit!!" << endl;
+         _fail = true;
+      }
+      else if(!packBits(tok, len, row)){
+         size_t i = 0;
+         while(pat[i]=='0' || pat[i]=='1') ++i;
+         cerr << "Error: Pattern(" << pat << ") contains a non-0/1 character(\'"
+              << pat[i] << "\')." << endl;
+         _fail = true;
+      }
+      else ++num;
+   }
+   if(_fail || num==0) return 0;
+   for(size_t j=num ; j<64 ; ++j){
+      for(size_t w=0 ; w<_nWords ; ++w){ _rows[j*_nWords+w] = 0; }
+   }
+   size_t tile[64];
+   for(size_t w=0 ; w<_nWords ; ++w){
+      for(size_t j=0 ; j<64 ; ++j){ tile[j] = _rows[j*_nWords+w]; }
+      transpose64(tile);
+      const size_t n = (_nPi-64*w<64)? _nPi-64*w: 64;
+      for(size_t i=0 ; i<n ; ++i){ words[64*w+i] = tile[i]; }
+   }
+   return num;
+}
+
+// Skip the blanks up to the next pattern and return false at the end of
+// the file. With tok, also take the whole pattern, reading more of the
+// file until a blank or the end of the file is found after it.
+bool
+CirPatternReader::nextToken(const char** tok, size_t* len)
+{
+   while(true){
+      while(_begin<_end && isBlank(_buf[_begin])) ++_begin;
+      if(_begin<_end) break;
+      if(_eof) return false;
+      refill();
+   }
+   if(tok==0) return true;
+   size_t i = _begin;
+   while(true){
+      while(i<_end && !isBlank(_buf[i])) ++i;
+      if(i<_end || _eof) break;
+      i -= _begin;
+      refill();
+      i += _begin;
+   }
+   *tok = &_buf[_begin];
+   *len = i-_begin;
+   _begin = i;
+   return true;
+}
+
+// Move the unparsed part to the front of _buf, growing it if it is full,
+// and append as much of the file as fits
+bool
+CirPatternReader::refill()
+{
+   if(_begin!=0){
+      memmove(&_buf[0], &_buf[_begin], _end-_begin);
+      _end -= _begin;
+      _begin = 0;
+   }
+   if(_end==_buf.size()) _buf.resize(2*_buf.size());
+   _is.read(&_buf[_end], _buf.size()-_end);
+   const size_t n = _is.gcount();
+   _end += n;
+   if(!_is || n==0) _eof = true;
+   return (n!=0);
+}
+
+/********************************************/
+/*   class CirPatternMap member functions   */
+/********************************************/
+bool
+CirPatternMap::open(const string& fileName)
+{
+   close();
+   const int fd = ::open(fileName.c_str(), O_RDONLY);
+   if(fd<0) return false;
+   struct stat st;
+   if(fstat(fd, &st)!=0 || size_t(st.st_size)<3*sizeof(size_t)){
+      ::close(fd);
+      return true;
+   }
+   void* map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if(map==MAP_FAILED) return true;
+   _map = map;
+   _mapSize = st.st_size;
+   _header = (const size_t*)map;
+   // The size must match the header exactly, so that no record runs past
+   // the end of the map
+   const size_t nPi = numPi(), nRec = numRecords();
+   if(memcmp(_header, patternMagic, sizeof(patternMagic))!=0 ||
+      numPatterns()>size_t(-1)-63 || (nPi!=0 && nRec>_mapSize/8/nPi) ||
+      _mapSize!=(3+nRec*nPi)*sizeof(size_t)){
+      close();
+      return true;
+   }
+   madvise(_map, _mapSize, MADV_SEQUENTIAL);
+   return true;
+}
+
+void
+CirPatternMap::close()
+{
+   if(_map!=0) munmap(_map, _mapSize);
+   _map = 0;
+   _mapSize = 0;
+}
+
+// The header is completed once all the patterns are read, so os must be
+// seekable
+bool
+CirPatternMap::convert(istream& is, ostream& os, size_t nPi, size_t& num)
+{
+   CirPatternReader reader(is, nPi);
+   vector<size_t> words(nPi);
+   // The magic is written last, so a file cut short by a bad pattern is
+   // never taken for a pattern file
+   size_t header[3] = { 0, nPi, 0 };
+   const streampos start = os.tellp();
+   os.write((const char*)header, sizeof(header));
+   num = 0;
+   for(size_t n ; (n = reader.read(words.empty()? 0: &words[0])) != 0 ; num += n){
+      os.write((const char*)(words.empty()? 0: &words[0]), nPi*sizeof(size_t));
+   }
+   if(reader.fail()) return false;
+   memcpy(header, patternMagic, sizeof(patternMagic));
+   header[2] = num;
+   os.seekp(start);
+   os.write((const char*)header, sizeof(header));
+   os.seekp(0, ios::end);
+   return true;
+}
+
+/****************************************/
+/*   class CirSimLog member functions   */
+/****************************************/
+CirSimLog::CirSimLog(ostream& os, size_t nPi, size_t nPo, bool raw)
+   : _out(os, 1 << 20), _nPi(nPi), _nPo(nPo), _raw(raw), _lineSize(nPi+nPo+2)
+{
+   if(_raw){
+      size_t header[3] = { 0, nPi, nPo };
+      memcpy(header, logMagic, sizeof(logMagic));
+      _out.write((const char*)header, sizeof(header));
+      return;
+   }
+   _rows.resize(64*((nPi+63)/64 + (nPo+63)/64));
+   // putRow() writes whole bytes, up to 7 characters past a line
+   _text.resize(64*_lineSize + 8);
+}
+
+void
+CirSimLog::write(size_t num, const size_t* pi, const size_t* po)
+{
+   if(_raw){
+      _out.write((const char*)&num, sizeof(num));
+      _out.write((const char*)pi, _nPi*sizeof(size_t));
+      _out.write((const char*)po, _nPo*sizeof(size_t));
+      return;
+   }
+   const size_t piWords = (_nPi+63)/64, poWords = (_nPo+63)/64;
+   size_t* piRows = _rows.empty()? 0: &_rows[0];
+   size_t* poRows = piRows+64*piWords;
+   toRows(pi, _nPi, piRows);
+   toRows(po, _nPo, poRows);
+   // The lines are filled in order, so the bytes written past one are
+   // overwritten by the next
+   char* p = &_text[0];
+   for(size_t j=0 ; j<num ; ++j){
+      p = putRow(p, piRows+j*piWords, _nPi);
+      *p++ = ' ';
+      p = putRow(p, poRows+j*poWords, _nPo);
+      *p++ = '\n';
+   }
+   _out.write(&_text[0], p-&_text[0]);
+}
+
+// Transpose words[0..n-1] into 64 rows of (n+63)/64 words, row j holding
+// bit j of every word
+void
+CirSimLog::toRows(const size_t* words, size_t n, size_t* rows) const
+{
+   const size_t nWords = (n+63)/64;
+   size_t tile[64];
+   for(size_t w=0 ; w<nWords ; ++w){
+      const size_t m = (n-64*w<64)? n-64*w: 64;
+      for(size_t i=0 ; i<64 ; ++i){ tile[i] = (i<m)? words[64*w+i]: 0; }
+      transpose64(tile);
+      for(size_t j=0 ; j<64 ; ++j){ rows[j*nWords+w] = tile[j]; }
+   }
+}
+
+// Write the n bits of row as characters at p and return the end of them
+char*
+CirSimLog::putRow(char* p, const size_t* row, size_t n) const
+{
+   for(size_t i=0 ; i<n ; i+=8){
+      memcpy(p+i, bitChars[(row[i/64] >> (i%64)) & 0xff], 8);
+   }
+   return p+n;
+}
@@ -0,0 +1,123 @@
+/****************************************************************************
+  FileName     [ cirPattern.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define simulation pattern and log file I/O ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_PATTERN_H
+#define CIR_PATTERN_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include "myOutBuf.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------
+//   CirPatternReader: read a text pattern file, one string of nPi 0/1
+//   characters per pattern, separated by blanks or line breaks. The file
+//   is read in large blocks, and every 64 patterns are packed as rows of
+//   bits and turned into one word per PI by 64x64 bit transposes.
+//------------------------------------------------------------------------
+class CirPatternReader
+{
+public:
+   CirPatternReader(istream& is, size_t nPi);
+
+   // Put the next (up to) 64 patterns into words[0..nPi-1], pattern j in
+   // bit j, and return how many were read. 0 means the end of the file or
+   // a bad pattern; fail() tells them apart, and the error is reported.
+   size_t read(size_t* words);
+   bool fail() const { return _fail; }
+
+private:
+   istream&          _is;
+   size_t            _nPi;
+   size_t            _nWords;    // words per packed row
+   vector<char>      _buf;
+   size_t            _begin;     // unparsed part of _buf
+   size_t            _end;
+   bool              _eof;
+   bool              _fail;
+   vector<size_t>    _rows;      // 64 rows of _nWords words
+
+   bool nextToken(const char** tok, size_t* len);
+   bool refill();
+};
+
+//------------------------------------------------------------------------
+//   Binary pattern files hold the words that CirMgr::simulateWords()
+//   takes, in the byte order of the machine:
+//      the magic "CIRPAT1\n", the number of PIs and of patterns (1 word
+//      each), then one record of nPi words per 64 patterns, word i of
+//      record r holding patterns 64r..64r+63 of PI i. The unused bits of
+//      the last record are 0.
+//   CirPatternMap maps such a file into memory, so that each record is
+//   simulated where it lies.
+//------------------------------------------------------------------------
+class CirPatternMap
+{
+public:
+   CirPatternMap() : _map(0), _mapSize(0), _header(0) {}
+   ~CirPatternMap() { close(); }
+
+   // Return false if the file cannot be opened; a file that is not a
+   // binary pattern file is opened, but isValid() is false
+   bool open(const string& fileName);
+   void close();
+   bool isValid() const { return (_map!=0); }
+
+   size_t numPi() const { return _header[1]; }
+   size_t numPatterns() const { return _header[2]; }
+   size_t numRecords() const { return (numPatterns()+63)/64; }
+   const size_t* record(size_t r) const { return _header+3+r*numPi(); }
+
+   // Convert the text patterns of is for nPi PIs and write them to os.
+   // Return false at a bad pattern, which is reported by CirPatternReader.
+   static bool convert(istream& is, ostream& os, size_t nPi, size_t& num);
+
+private:
+   void*             _map;
+   size_t            _mapSize;
+   const size_t*     _header;
+};
+
+//------------------------------------------------------------------------
+//   CirSimLog: write the simulation log, one line per pattern with its PI
+//   values, a space and its PO values. Each 64 patterns are turned into
+//   rows by bit transposes, every byte of a row into 8 characters by a
+//   table lookup, and the lines are written through an OutBuf.
+//   The raw log keeps the words as they are, in the byte order of the
+//   machine: the magic "CIRLOG1\n", the number of PIs and of POs, then
+//   for each 64 patterns the number of patterns, nPi PI words and nPo PO
+//   words. The unused bits of the words are not cleared.
+//------------------------------------------------------------------------
+class CirSimLog
+{
+public:
+   CirSimLog(ostream& os, size_t nPi, size_t nPo, bool raw = false);
+   ~CirSimLog() {}
+
+   // Log patterns 0..num-1 of pi[0..nPi-1] and po[0..nPo-1], pattern j
+   // in bit j of each word
+   void write(size_t num, const size_t* pi, const size_t* po);
+
+private:
+   OutBuf            _out;
+   size_t            _nPi;
+   size_t            _nPo;
+   bool              _raw;
+   size_t            _lineSize;  // nPi+nPo+2
+   vector<size_t>    _rows;      // 64 rows of PI words, then of PO words
+   vector<char>      _text;      // 64 lines and some slack
+
+   void toRows(const size_t* words, size_t n, size_t* rows) const;
+   char* putRow(char* p, const size_t* row, size_t n) const;
+};
+
+#endif // CIR_PATTERN_H
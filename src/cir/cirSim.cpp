@@ -7,15 +7,17 @@
 ****************************************************************************/
 
 #include <fstream>
-#include <sstream>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
 #include <cassert>
 #include <bitset>
-#include <math.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "cirMgr.h"
 #include "cirGate.h"
+#include "cirPattern.h"
 #include "util.h"
 
 using namespace std;
@@ -32,101 +34,279 @@ using namespace std;
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// A kernel evaluates the n ANDs of order[] on W words (64*W patterns) per
+// gate. fanin[] holds the 2 fanin literals of each gate id (CirAig) and
+// value[] W consecutive words per id.
+typedef void (*SimKernel)(size_t n, const unsigned* order,
+                          const unsigned* fanin, size_t* value);
+
+// All ones for an inverted literal, 0 otherwise
+static inline size_t
+litMask(unsigned lit) { return size_t(0) - size_t(lit & 1); }
+
+template<unsigned W> static void
+simKernel(size_t n, const unsigned* order, const unsigned* fanin, size_t* value)
+{
+	for(size_t i=0 ; i<n ; ++i){
+		const unsigned l0 = fanin[2*order[i]], l1 = fanin[2*order[i]+1];
+		const size_t m0 = litMask(l0), m1 = litMask(l1);
+		size_t* o = value + size_t(order[i])*W;
+		const size_t* a = value + size_t(l0>>1)*W;
+		const size_t* b = value + size_t(l1>>1)*W;
+		for(unsigned w=0 ; w<W ; ++w){
+			o[w] = (a[w] ^ m0) & (b[w] ^ m1);
+		}
+	}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CIR_SIM_X86
+#include <immintrin.h>
+
+template<unsigned W> __attribute__((target("avx2"))) static void
+simKernelAvx2(size_t n, const unsigned* order, const unsigned* fanin, size_t* value)
+{
+	for(size_t i=0 ; i<n ; ++i){
+		const unsigned l0 = fanin[2*order[i]], l1 = fanin[2*order[i]+1];
+		const __m256i m0 = _mm256_set1_epi64x(litMask(l0));
+		const __m256i m1 = _mm256_set1_epi64x(litMask(l1));
+		size_t* o = value + size_t(order[i])*W;
+		const size_t* a = value + size_t(l0>>1)*W;
+		const size_t* b = value + size_t(l1>>1)*W;
+		for(unsigned w=0 ; w<W ; w+=4){
+			__m256i va = _mm256_loadu_si256((const __m256i*)(a+w));
+			__m256i vb = _mm256_loadu_si256((const __m256i*)(b+w));
+			_mm256_storeu_si256((__m256i*)(o+w),
+				_mm256_and_si256(_mm256_xor_si256(va, m0), _mm256_xor_si256(vb, m1)));
+		}
+	}
+}
+
+template<unsigned W> __attribute__((target("avx512f"))) static void
+simKernelAvx512(size_t n, const unsigned* order, const unsigned* fanin, size_t* value)
+{
+	for(size_t i=0 ; i<n ; ++i){
+		const unsigned l0 = fanin[2*order[i]], l1 = fanin[2*order[i]+1];
+		const __m512i m0 = _mm512_set1_epi64(litMask(l0));
+		const __m512i m1 = _mm512_set1_epi64(litMask(l1));
+		size_t* o = value + size_t(order[i])*W;
+		const size_t* a = value + size_t(l0>>1)*W;
+		const size_t* b = value + size_t(l1>>1)*W;
+		for(unsigned w=0 ; w<W ; w+=8){
+			__m512i va = _mm512_loadu_si512((const void*)(a+w));
+			__m512i vb = _mm512_loadu_si512((const void*)(b+w));
+			_mm512_storeu_si512((void*)(o+w),
+				_mm512_and_si512(_mm512_xor_si512(va, m0), _mm512_xor_si512(vb, m1)));
+		}
+	}
+}
+#endif
+
+// Kernels for 1, 4 and 8 words, picked once at startup from CPUID
+struct SimKernelTable
+{
+	SimKernelTable() {
+		_k1 = simKernel<1>; _k4 = simKernel<4>; _k8 = simKernel<8>;
+#ifdef CIR_SIM_X86
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2")){
+			_k4 = simKernelAvx2<4>; _k8 = simKernelAvx2<8>;
+		}
+		if(__builtin_cpu_supports("avx512f")){ _k8 = simKernelAvx512<8>; }
+#endif
+	}
+	SimKernel get(unsigned nWords) const {
+		return nWords==8? _k8: (nWords==4? _k4: _k1);
+	}
+	SimKernel _k1, _k4, _k8;
+};
+
+static const SimKernelTable simKernels;
+
+// Threads kept for the rounds of one randomSim() call. Block t of a round
+// is simulated by participant t%P, where the P participants are the
+// calling thread and P-1 threads started here; P is nBlocks, at most the
+// number of cores.
+class SimWorkers
+{
+public:
+	SimWorkers(unsigned nBlocks) : _nBlocks(nBlocks), _round(0), _busy(0), _stop(false) {
+		unsigned nPart = thread::hardware_concurrency();
+		if(nPart==0 || nPart>nBlocks) nPart = nBlocks;
+		for(unsigned p=1 ; p<nPart ; ++p){ _threads.push_back(thread(&SimWorkers::loop, this, p)); }
+	}
+	~SimWorkers() {
+		{
+			lock_guard<mutex> lock(_lock);
+			_stop = true;
+		}
+		_start.notify_all();
+		for(size_t i=0 ; i<_threads.size() ; ++i){ _threads[i].join(); }
+	}
+
+	// Run kernel on all blocks of value[] and return when they are done
+	void run(SimKernel kernel, size_t n, const unsigned* order, const unsigned* fanin,
+	         size_t* value, size_t blockSize) {
+		{
+			lock_guard<mutex> lock(_lock);
+			_kernel = kernel; _n = n; _order = order; _fanin = fanin;
+			_value = value; _blockSize = blockSize;
+			_busy = _threads.size();
+			++_round;
+		}
+		_start.notify_all();
+		work(0);
+		unique_lock<mutex> lock(_lock);
+		while(_busy!=0){ _done.wait(lock); }
+	}
+
+private:
+	unsigned            _nBlocks;
+	vector<thread>      _threads;
+	mutex               _lock;
+	condition_variable  _start;
+	condition_variable  _done;
+	size_t              _round;
+	size_t              _busy;       // threads still in this round
+	bool                _stop;
+	// The work of the current round
+	SimKernel           _kernel;
+	size_t              _n;
+	const unsigned*     _order;
+	const unsigned*     _fanin;
+	size_t*             _value;
+	size_t              _blockSize;
+
+	void work(unsigned p) {
+		for(unsigned t=p ; t<_nBlocks ; t+=_threads.size()+1){
+			_kernel(_n, _order, _fanin, _value+t*_blockSize);
+		}
+	}
+	void loop(unsigned p) {
+		size_t done = 0;
+		while(true){
+			unique_lock<mutex> lock(_lock);
+			while(!_stop && _round==done){ _start.wait(lock); }
+			if(_stop) return;
+			done = _round;
+			lock.unlock();
+			work(p);
+			lock.lock();
+			if(--_busy==0) _done.notify_one();
+		}
+	}
+};
+
+// Orders gate ids on their simulation words in all blocks of _simValue.
+// A signature with the top bit of its first word set is complemented
+// first, so a gate and its inverse compare equal.
+struct SimSignature
+{
+	SimSignature(const size_t* v, unsigned nWords, unsigned nBlocks, size_t blockSize)
+		: _value(v), _nWords(nWords), _nBlocks(nBlocks), _blockSize(blockSize) {}
+	int compare(unsigned a, unsigned b) const {
+		const size_t* va = _value + size_t(a)*_nWords;
+		const size_t* vb = _value + size_t(b)*_nWords;
+		const size_t ia = (va[0] > (SIZE_MAX/2))? ~size_t(0): 0;
+		const size_t ib = (vb[0] > (SIZE_MAX/2))? ~size_t(0): 0;
+		for(unsigned t=0 ; t<_nBlocks ; ++t){
+			for(unsigned w=0 ; w<_nWords ; ++w){
+				size_t x = va[t*_blockSize+w] ^ ia, y = vb[t*_blockSize+w] ^ ib;
+				if(x!=y) return (x<y)? -1: 1;
+			}
+		}
+		return 0;
+	}
+	bool operator() (unsigned a, unsigned b) const { return compare(a, b) < 0; }
+	bool equal(unsigned a, unsigned b) const { return compare(a, b) == 0; }
+
+	const size_t* _value;
+	unsigned      _nWords;
+	unsigned      _nBlocks;
+	size_t        _blockSize;
+};
 
 /************************************************/
 /*   Public member functions about Simulation   */
 /************************************************/
+// Each round draws nWords words (64*nWords patterns) per PI for each of the
+// nThreads blocks and simulates the blocks on up to nThreads threads,
+// started once for the whole call. The FEC
+// groups are then split once on the words of all blocks together.
+// Block t takes its words from a copy of _simGen jumped t times; the next
+// call goes on from where block 0 stopped.
 void
-CirMgr::randomSim()
+CirMgr::randomSim(unsigned nWords, unsigned nThreads)
 {
-	bitset<SIZE_T> ParalPattern[_Pi];
+	if(nWords!=4 && nWords!=8) nWords = 1;
+	if(nThreads<1) nThreads = 1;
+	const unsigned nSig = nWords*nThreads;
+	const size_t blockSize = _Pi*nWords;
+	vector<size_t> pattern(blockSize*nThreads);
+	vector<RandomWordGen> gen(nThreads, _simGen);
+	SimWorkers workers(nThreads);
+	for(unsigned t=1 ; t<nThreads ; ++t){
+		for(unsigned j=0 ; j<t ; ++j){ gen[t].jump(); }
+	}
+	const size_t nPi = _Pi;
+	vector<size_t> piWords(_simLog!=0? nPi: 0);
 	size_t patternSim = 0;
 	size_t stop = 0;
 	while(stop<20){
-		for(size_t i=0 ; i<_Pi ; ++i){
-			size_t patternSim = rnGen(INT_MAX);
-			for(int i=0 ; i<3 ; ++i){
-				patternSim = patternSim*pow(2,16);
-				patternSim += rnGen(INT_MAX);
-			}
-			ParalPattern[i] = patternSim;
+		for(unsigned t=0 ; t<nThreads && blockSize!=0 ; ++t){
+			gen[t].fill(&pattern[t*blockSize], blockSize);
 		}
 		if(_simFirst){ initFECGrps(); }
-		simulate(ParalPattern);
-  		size_t originGrps = _FECGrps.size();
+		simulateWords(pattern.empty()? 0: &pattern[0], nWords, nThreads, &workers);
+		size_t originGrps = fecGrpNum();
 		splitFECGrps();
-		if(_FECGrps.size() == 0) break;
-		int formula = _FECGrps.size()-originGrps;
+		if(fecGrpNum() == 0) break;
+		int formula = fecGrpNum()-originGrps;
 		if(formula>=originGrps/1000*(-1) && (formula <= (originGrps/1000))) stop++;
 		else if(formula == 0)stop++;
 		else stop = 0;
 		// Write logFile
-		if(_simLog!=0){ writeLogFile(SIZE_T, ParalPattern); }
-		patternSim += SIZE_T;
+		if(_simLog!=0){
+			for(unsigned b=0 ; b<nSig ; ++b){
+				const unsigned t = b/nWords, w = b%nWords;
+				loadSimWord(w, t);
+				for(size_t i=0 ; i<nPi ; ++i){ piWords[i] = pattern[t*blockSize+i*nWords+w]; }
+				writeLogFile(SIZE_T, piWords.empty()? 0: &piWords[0]);
+			}
+		}
+		patternSim += SIZE_T*nSig;
 	}
+	_simGen = gen[0];
+	// Every word splits the groups the same way, so any of them gives the
+	// gates values of the right polarity for fraig
+	loadSimWord(0);
 	cout <<char(13) << setw(30) << ' ' << char(13);
 	cout << patternSim << " patterns simulated."<<endl;
 	// Sort the Grps and all Grp and record the Grp number in gate
 	sortAndRecord();
 }
 
+// The patterns are simulated 64 at a time; a bad pattern stops the run
+// and drops the patterns read since the last simulation.
 void
 CirMgr::fileSim(ifstream& patternFile)
 {
-	istringstream iss;
-	size_t patternSim = 0;
-	size_t num = 0;
-	string temp_line = "";
-	bitset<SIZE_T> ParalPattern[_Pi];
-	// read a pattern in file
-	while(getline(patternFile , temp_line , '\n')){
-		if(temp_line.empty()) continue;
-		iss = istringstream(temp_line);
-   		while(getline(iss,temp_line,' ')){
-			if(temp_line.empty()) continue;
-			if(temp_line.length()!=_Pi){ 
-				cerr << "Error: Pattern(" << temp_line << ") length(" << temp_line.length()
-					 <<") does not match the number of inputs("<<_Pi<<") in a circuit!!"<<endl;
-				cout << patternSim << " patterns simulated."<<endl;
-				return;
-			}
-			for(int i=0 ; i<_Pi ; ++i){
-				if(temp_line[i]!='0' && temp_line[i]!='1'){
-					cerr << "Error: Pattern(" << temp_line << ") contains a non-0/1 character(\'"
-					     << temp_line[i] << "\')." << endl;
-					cout << patternSim << " patterns simulated."<<endl;
-					return;
-				}
-				ParalPattern[i][num] = temp_line[i]-'0';
-			}
-			num++ ;
-			// If the parallel pattern is full, do simulatation
-			if(num >= SIZE_T){
-				if(_simFirst){ initFECGrps(); }
-				simulate(ParalPattern);
-				splitFECGrps();
-				// Write logFile
-				if(_simLog!=0){ writeLogFile(num, ParalPattern); }
-				patternSim += SIZE_T;
-				num = 0;
-			}
-		}
-	}
-	// If there are patterns left, do simulatation
-	if(num!=0){
-		//Pad the parallel pattern with 0
-		for(int i=num ; i<SIZE_T ; ++i){
-			for(int j=0 ; j<_Pi ; ++j){
-				ParalPattern[j][i]=0;
-			}
-		}
+	CirPatternReader reader(patternFile, _Pi);
+	vector<size_t> pattern(_Pi);
+	size_t patternSim = 0, num;
+	while((num = reader.read(pattern.empty()? 0: &pattern[0])) != 0){
 		if(_simFirst){ initFECGrps(); }
-		simulate(ParalPattern);
+		simulateWords(pattern.empty()? 0: &pattern[0], 1);
+		loadSimWord(0);
 		splitFECGrps();
 		// Write logFile
-		if(_simLog!=0){ writeLogFile(num, ParalPattern); }
+		if(_simLog!=0){ writeLogFile(num, pattern.empty()? 0: &pattern[0]); }
 		patternSim += num;
 	}
+	if(reader.fail()){
+		cout << patternSim << " patterns simulated."<<endl;
+		return;
+	}
 	cout <<char(13) << setw(30) << ' ' << char(13);
 	cout << patternSim << " patterns simulated."<<endl;
 	// Sort the Grps and all Grp and record the Grp number in gate
@@ -134,101 +314,225 @@ CirMgr::fileSim(ifstream& patternFile)
 }
 
 
+// Replay a binary pattern file: each record is already the word per PI
+// that simulateWords() takes, so it is simulated straight from the map.
+void
+CirMgr::fileSim(const CirPatternMap& patterns)
+{
+	if(patterns.numPi()!=size_t(_Pi)){
+		cerr << "Error: Patterns for " << patterns.numPi()
+		     << " inputs do not match the number of inputs(" << _Pi << ") in a circuit!!" << endl;
+		cout << "0 patterns simulated." << endl;
+		return;
+	}
+	const size_t nRec = patterns.numRecords();
+	for(size_t r=0 ; r<nRec ; ++r){
+		const size_t* pattern = patterns.record(r);
+		if(_simFirst){ initFECGrps(); }
+		simulateWords(pattern, 1);
+		loadSimWord(0);
+		splitFECGrps();
+		// Write logFile
+		if(_simLog!=0){
+			const size_t num = (r+1<nRec)? SIZE_T: patterns.numPatterns()-r*SIZE_T;
+			writeLogFile(num, pattern);
+		}
+	}
+	cout <<char(13) << setw(30) << ' ' << char(13);
+	cout << patterns.numPatterns() << " patterns simulated."<<endl;
+	// Sort the Grps and all Grp and record the Grp number in gate
+	sortAndRecord();
+}
+
+// Write the text patterns of textFile as a binary pattern file for the
+// PIs of the circuit
+bool
+CirMgr::convertPatterns(ifstream& textFile, ofstream& binFile)
+{
+	size_t num = 0;
+	if(!CirPatternMap::convert(textFile, binFile, _Pi, num) || !binFile){
+		cout << "0 patterns converted." << endl;
+		return false;
+	}
+	cout << num << " patterns converted." << endl;
+	return true;
+}
+
+
+// Simulate one 64-pattern word and store the values in the gates.
 void
 CirMgr::simulate(bitset<SIZE_T> ParalPattern[])
 {
-	CirGate::setGlobalRef();
+	const size_t nPi = _Pi;
+	vector<size_t> pattern(nPi);
+	for(size_t i=0 ; i<nPi ; ++i){ pattern[i] = ParalPattern[i].to_ullong(); }
+	simulateWords(pattern.empty()? 0: &pattern[0], 1);
+	loadSimWord(0);
+}
+
+// Evaluate the ANDs of _aig in topological order. CONST 0 and UNDEF gates
+// keep value 0. pattern[] holds nBlocks blocks of nWords words per PI.
+// Each block has its own slice of _simValue. With workers, the blocks are
+// simulated by its threads over the shared read-only order, otherwise one
+// after another.
+// The values are kept until loadSimWord() copies one word to the gates.
+void
+CirMgr::simulateWords(const size_t* pattern, unsigned nWords, unsigned nBlocks,
+                      SimWorkers* workers)
+{
+	if(!_aigReady){
+		buildAig();
+		_simValue.assign(_totalList.size()*_simWords*_simBlocks, 0);
+	}
+	if(_simWords!=nWords || _simBlocks!=nBlocks){
+		_simWords = nWords;
+		_simBlocks = nBlocks;
+		_simValue.assign(_totalList.size()*nWords*nBlocks, 0);
+	}
+	const size_t blockSize = _totalList.size()*nWords;
+	const size_t nPi = _Pi;
 	// Set PI
-	for(size_t i=0 ; i<_Pi ; ++i){
-		_piList[i]->setValue( ParalPattern[i].to_ullong() );
+	for(unsigned t=0 ; t<nBlocks ; ++t){
+		size_t* value = &_simValue[t*blockSize];
+		const size_t* p = pattern + t*nPi*nWords;
+		for(size_t i=0 ; i<nPi ; ++i){
+			for(unsigned w=0 ; w<nWords ; ++w){
+				value[size_t(_piList[i]->getId())*nWords+w] = p[i*nWords+w];
+			}
+		}
 	}
-	// Simulate from every PO
-	for(size_t i=0 ; i<_Po ; ++i){
-		_totalList[_Max+1+i]->simulate(_simFirst);
+	const vector<unsigned>& order = _aig.andOrder();
+	if(!order.empty()){
+		SimKernel kernel = simKernels.get(nWords);
+		if(workers!=0){
+			workers->run(kernel, order.size(), &order[0], _aig.faninData(),
+			             &_simValue[0], blockSize);
+		}
+		else{
+			for(unsigned t=0 ; t<nBlocks ; ++t){
+				kernel(order.size(), &order[0], _aig.faninData(), &_simValue[t*blockSize]);
+			}
+		}
 	}
 	_simFirst = false;
 }
 
+// Copy word w of block b of the last simulateWords() to the PI, AIG and
+// PO gates.
+void
+CirMgr::loadSimWord(unsigned w, unsigned b)
+{
+	const unsigned W = _simWords;
+	const size_t* value = &_simValue[b*_totalList.size()*W];
+	const size_t nPi = _Pi, nPo = _Po;
+	for(size_t i=0 ; i<nPi ; ++i){
+		_piList[i]->setValue(value[size_t(_piList[i]->getId())*W+w]);
+	}
+	// Gates merged away by fraig are still evaluated but have no CirGate
+	const vector<unsigned>& order = _aig.andOrder();
+	for(size_t i=0, n=order.size() ; i<n ; ++i){
+		if(_totalList[order[i]]!=0) _totalList[order[i]]->setValue(value[size_t(order[i])*W+w]);
+	}
+	for(size_t i=0 ; i<nPo ; ++i){
+		const unsigned lit = _aig.fanin(_Max+1+i, 0);
+		_totalList[_Max+1+i]->setValue(value[size_t(CirAig::litId(lit))*W+w] ^ litMask(lit));
+	}
+}
+
+// All AIGs and CONST 0 start in one group, in DFS order
 void 
 CirMgr::initFECGrps()
 {
-	FECGrp Grp;
-	Grp.push_back(0);
+	_fecGate.clear();
+	_fecGate.push_back(0);
 	for(size_t i=0 ; i<_dfsList.size() ; ++i){
-		if(_dfsList[i]->getTypeStr()!="AIG") continue;
-		Grp.push_back(_dfsList[i]->getId());
+		CirGate* g = dfsGate(i);
+		if(g==0 || !g->isAig()) continue;
+		_fecGate.push_back(g->getId());
 	}
-	_FECGrps.push_back(Grp);
+	_fecBegin.assign(1, 0);
+	_fecBegin.push_back(_fecGate.size());
+	_fecNewBegin.reserve(_fecGate.size()/2+2);
 }
 
+// Refine the groups in place on the signature of the last simulateWords():
+// each group segment of _fecGate is sorted on the signature, runs of equal
+// signatures become the new groups and are packed to the front. Gates left
+// alone are dropped. Only _fecNewBegin, reserved by initFECGrps(), is
+// written besides _fecGate, so no memory is allocated per round.
 void 
 CirMgr::splitFECGrps()
 {
-	size_t _FECGrpsSize=_FECGrps.size();
-	for(size_t grpnum=0 ; grpnum<_FECGrpsSize ; ++grpnum){
-		HashMap<simValueKey, FECGrp> newFecGrps(_FECGrps[grpnum].size());
-		for(size_t i=0 ; i<_FECGrps[grpnum].size() ; ++i){
-			simValueKey key(_totalList[_FECGrps[grpnum][i]]->getValue());
-			FECGrp grp;
-			grp.push_back(_FECGrps[grpnum][i]);
-			FECGrp* grpPtr = &grp;
-			// If its group already existed, add _FECGrps[grpnum][i] in it
-			if(newFecGrps.queryAndInsert(key, grpPtr)){
-				(*grpPtr).push_back(_FECGrps[grpnum][i]);
-			}
-		}
-		// Collect valid FecGrp in the hash
-		HashMap<simValueKey, FECGrp>::iterator itr = newFecGrps.begin();
-		while(itr != newFecGrps.end()){
-			if((*itr).second.size()>1){
-				_FECGrps.push_back((*itr).second);
+	const SimSignature sig(&_simValue[0], _simWords, _simBlocks, _totalList.size()*_simWords);
+	size_t out = 0;
+	_fecNewBegin.clear();
+	for(size_t grpnum=0 ; grpnum+1<_fecBegin.size() ; ++grpnum){
+		const size_t begin = _fecBegin[grpnum], end = _fecBegin[grpnum+1];
+		sort(_fecGate.begin()+begin, _fecGate.begin()+end, sig);
+		for(size_t i=begin, j ; i<end ; i=j){
+			for(j=i+1 ; j<end && sig.equal(_fecGate[i], _fecGate[j]) ; ++j) ;
+			if(j-i==1){
+				_totalList[_fecGate[i]]->removeGrp();
+				continue;
 			}
-			if((*itr).second.size()==1){ _totalList[((*itr).second)[0]]->removeGrp();}
-			++itr;
+			_fecNewBegin.push_back(out);
+			for(size_t k=i ; k<j ; ++k){ _fecGate[out++] = _fecGate[k]; }
 		}
 	}
-	if(_FECGrpsSize!=0){
-		_FECGrps.erase(_FECGrps.begin(), _FECGrps.begin()+_FECGrpsSize);
-	}
+	_fecNewBegin.push_back(out);
+	_fecGate.resize(out);
+	_fecBegin.swap(_fecNewBegin);
 	cout <<char(13) << setw(30) << ' ' << char(13)<<flush;
-	cout << "Total #FEC Group = " << _FECGrps.size() << flush;
+	cout << "Total #FEC Group = " << fecGrpNum() << flush;
 }
 
-
+// Sort the gates of each group and the groups by their first gate, then
+// record the group index in every gate
 void
 CirMgr::sortAndRecord()
 {
-	// Sort all Grp
-	for(size_t i=0 ; i<_FECGrps.size() ; ++i){
-		sort(_FECGrps[i].begin(), _FECGrps[i].end());
+	const size_t nGrp = fecGrpNum();
+	vector<pair<unsigned, size_t> > order(nGrp);   // (first gate, group)
+	for(size_t i=0 ; i<nGrp ; ++i){
+		sort(_fecGate.begin()+_fecBegin[i], _fecGate.begin()+_fecBegin[i+1]);
+		order[i] = make_pair(_fecGate[_fecBegin[i]], i);
 	}
-	// Sort the Grps
-	sort(_FECGrps.begin(), _FECGrps.end(), sortFECGrp);
-	// Record the Grp number in gate
-	for(size_t i=0 ; i<_FECGrps.size() ; ++i){
-		for(size_t j=0 ; j<_FECGrps[i].size() ; ++j)
-			_totalList[_FECGrps[i][j]]->setGrp(i);
+	sort(order.begin(), order.end());
+	vector<unsigned> gates;
+	gates.reserve(_fecGate.size());
+	_fecNewBegin.clear();
+	for(size_t i=0 ; i<nGrp ; ++i){
+		_fecNewBegin.push_back(gates.size());
+		const size_t g = order[i].second;
+		for(size_t k=_fecBegin[g] ; k<_fecBegin[g+1] ; ++k){
+			gates.push_back(_fecGate[k]);
+			_totalList[_fecGate[k]]->setGrp(i);
+		}
 	}
+	_fecNewBegin.push_back(gates.size());
+	_fecGate.swap(gates);
+	_fecBegin.swap(_fecNewBegin);
 }
 
-
+// Log the first num patterns of the last loadSimWord(): the PI words are
+// given, and the PO words are taken from the PO gates
 void
-CirMgr::writeLogFile(size_t num, bitset<SIZE_T> ParalPattern[])
+CirMgr::writeLogFile(size_t num, const size_t* pi)
 {
-	bitset<SIZE_T> Po[_Po];
+	vector<size_t> po(_Po);
 	for(size_t i=0 ; i<_Po ; ++i){
-		Po[i] = _totalList[_Max+1+i]->getValue();
+		po[i] = _totalList[_Max+1+i]->getValue();
 	}
-	for(size_t i=0 ; i<num ; ++i){
-		for(size_t j=0 ; j<_Pi ; ++j){
-			(*_simLog)<<ParalPattern[j][i];
-		}
-		(*_simLog)<<" ";
-		for(size_t j=0 ; j<_Po ; ++j){
-			(*_simLog)<<Po[j][i];
-		}
-		(*_simLog)<<endl;
-	} 
+	_simLog->write(num, pi, po.empty()? 0: &po[0]);
+}
+
+// The log is written through a CirSimLog until setSimLog(0), which flushes
+// it to logFile
+void
+CirMgr::setSimLog(ofstream *logFile, bool raw)
+{
+	delete _simLog;
+	_simLog = (logFile!=0)? new CirSimLog(*logFile, _Pi, _Po, raw): 0;
 }
 
 
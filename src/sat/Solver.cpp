@@ -678,8 +678,8 @@ lbool Solver::search(int nof_conflicts, int nof_learnts, const SearchParams& par
         }else{
             // NO CONFLICT
 
-            if (nof_conflicts >= 0 && conflictC >= nof_conflicts){
-                // Reached bound on number of conflicts:
+            if ((nof_conflicts >= 0 && conflictC >= nof_conflicts) || !withinBudget()){
+                // Reached bound on number of conflicts (or the budget of 'solveLimited()'):
                 progress_estimate = progressEstimate();
                 cancelUntil(root_level);
                 return l_Undef; }
@@ -745,7 +745,7 @@ void Solver::claRescaleActivity()
 
 /*_________________________________________________________________________________________________
 |
-|  solve : (assumps : const vec<Lit>&)  ->  [bool]
+|  solveLimited : (assumps : const vec<Lit>&)  ->  [lbool]
 |  
 |  Description:
 |    Top-level solve. If using assumptions (non-empty 'assumps' vector), you must call
@@ -755,11 +755,15 @@ void Solver::claRescaleActivity()
 |  Input:
 |    A list of assumptions (unit clauses coded as literals). Pre-condition: The assumptions must
 |    not contain both 'x' and '~x' for any variable 'x'.
+|  
+|  Output:
+|    'l_True' if satisfiable, 'l_False' if unsatisfiable, 'l_Undef' if the conflict or
+|    propagation budget (see 'setConfBudget()'/'setPropBudget()') ran out first.
 |________________________________________________________________________________________________@*/
-bool Solver::solve(const vec<Lit>& assumps)
+lbool Solver::solveLimited(const vec<Lit>& assumps)
 {
     simplifyDB();
-    if (!ok) return false;
+    if (!ok) return l_False;
 
     SearchParams    params(default_params);
     double  nof_conflicts = 100;
@@ -782,12 +786,12 @@ bool Solver::solve(const vec<Lit>& assumps)
                 if (proof != NULL) conflict_id = unit_id[var(p)];
             }
             cancelUntil(0);
-            return false; }
+            return l_False; }
         Clause* confl = propagate();
         if (confl != NULL){
             analyzeFinal(confl), assert(conflict.size() > 0);
             cancelUntil(0);
-            return false; }
+            return l_False; }
     }
     assert(root_level == decisionLevel());
 
@@ -803,7 +807,7 @@ bool Solver::solve(const vec<Lit>& assumps)
         reportf("===================================\n");
     }
 
-    while (status == l_Undef){
+    while (status == l_Undef && withinBudget()){
         if (verbosity >= 1){
             printStats();
             reportf("| %9d | %7d %8d | %7d %7d %8d %7.1f | %6.3f %% |\n",
@@ -820,8 +824,9 @@ bool Solver::solve(const vec<Lit>& assumps)
         nof_learnts   *= 1.1;
 
 if ((int)stats.conflicts >= effLimit) {
+   // Out of the global limit: undecided unless this round finished
    cancelUntil(0);
-   return status == l_True;
+   return status;
 }
     }
     if (verbosity >= 1) {
@@ -830,7 +835,7 @@ if ((int)stats.conflicts >= effLimit) {
     }
 
     cancelUntil(0);
-    return status == l_True;
+    return status;
 }
 
 void Solver::printStats()
@@ -73,6 +73,8 @@ protected:
     int                 qhead;            // Head of queue (as index into the trail -- no more explicit propagation queue in MiniSat).
     int                 simpDB_assigns;   // Number of top-level assignments since last execution of 'simplifyDB()'.
     int64               simpDB_props;     // Remaining number of propagations that must be made before next execution of 'simplifyDB()'.
+    int64               conflict_budget;  // 'stats.conflicts' at which 'solveLimited()' gives up. -1 means no budget.
+    int64               propagation_budget; // 'stats.propagations' at which 'solveLimited()' gives up. -1 means no budget.
 
     // Temporaries (to reduce allocation overhead). Each variable is prefixed by the method in which is used:
     //
@@ -121,6 +123,9 @@ protected:
     bool     simplify        (Clause* c) const;
 
     int      decisionLevel() const { return trail_lim.size(); }
+    bool     withinBudget() const {
+        return (conflict_budget    < 0 || stats.conflicts    < conflict_budget)
+            && (propagation_budget < 0 || stats.propagations < propagation_budget); }
 
 public:
     Solver() : ok               (true)
@@ -132,6 +137,8 @@ public:
              , qhead            (0)
              , simpDB_assigns   (0)
              , simpDB_props     (0)
+             , conflict_budget  (-1)
+             , propagation_budget(-1)
              , default_params   (SearchParams(0.95, 0.999, 0.02))
              , expensive_ccmin  (2)
              , proof            (NULL)
@@ -190,9 +197,16 @@ public:
     //
     bool    okay() { return ok; }       // FALSE means solver is in an conflicting state (must never be used again!)
     void    simplifyDB();
-    bool    solve(const vec<Lit>& assumps);
+    bool    solve(const vec<Lit>& assumps) { budgetOff(); return solveLimited(assumps) == l_True; }
     bool    solve() { vec<Lit> tmp; return solve(tmp); }
 
+    // Resource limits for 'solveLimited()', counted from the current statistics. 'l_Undef' is
+    // returned if a budget runs out before the problem is decided.
+    void    setConfBudget(int64 x) { conflict_budget    = stats.conflicts    + x; }
+    void    setPropBudget(int64 x) { propagation_budget = stats.propagations + x; }
+    void    budgetOff    ()        { conflict_budget = propagation_budget = -1; }
+    lbool   solveLimited (const vec<Lit>& assumps);
+
     double      progress_estimate;  // Set by 'search()'.
     vec<lbool>  model;              // If problem is satisfiable, this vector contains the model (if any).
     vec<Lit>    conflict;           // If problem is unsatisfiable under assumptions, this vector represent the conflict clause expressed in the assumptions.
@@ -71,6 +71,13 @@ class SatSolver
          _assump.push(val? Lit(prop): ~Lit(prop));
       }
       bool assumpSolve() { return _solver->solve(_assump); }
+      // Give up after "conflicts" conflicts (no limit if negative)
+      // Return l_True/l_False/l_Undef; l_Undef means undecided
+      lbool assumpSolveLimited(int conflicts) {
+         if (conflicts < 0) _solver->budgetOff();
+         else _solver->setConfBudget(conflicts);
+         return _solver->solveLimited(_assump);
+      }
 
       // For one time proof, use "solve"
       void assertProperty(Var prop, bool val) {
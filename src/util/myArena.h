@@ -0,0 +1,99 @@
+/****************************************************************************
+  FileName     [ myArena.h ]
+  PackageName  [ util ]
+  Synopsis     [ Define arena memory manager ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2007-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_ARENA_H
+#define MY_ARENA_H
+
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    Arena: carve objects out of large blocks and return all of them at
+//    once in release() or the destructor. Nothing in it is destructed;
+//    only objects that own no other memory should be placed here.
+//    free() keeps a chunk of up to MAX_RECYCLE bytes on a list of its size
+//    for the next alloc() of that size; larger chunks wait for release().
+//    Chunks are aligned to 8 bytes.
+//----------------------------------------------------------------------
+class Arena
+{
+public:
+   enum { ARENA_ALIGN = 8, MAX_RECYCLE = 512 };
+
+   Arena(size_t blockSize = 1 << 20)
+   : _blockSize(blockSize), _ptr(0), _left(0), _used(0),
+     _recycle(MAX_RECYCLE / ARENA_ALIGN + 1, 0) {}
+   ~Arena() { release(); }
+
+   void* alloc(size_t bytes) {
+      bytes = roundUp(bytes);
+      if (bytes <= MAX_RECYCLE && _recycle[bytes / ARENA_ALIGN] != 0) {
+         Chunk* c = _recycle[bytes / ARENA_ALIGN];
+         _recycle[bytes / ARENA_ALIGN] = c->_next;
+         return c;
+      }
+      _used += bytes;
+      if (bytes > _blockSize / 4) return newBlock(bytes);
+      if (bytes > _left) {
+         _ptr = (char*)newBlock(_blockSize);
+         _left = _blockSize;
+      }
+      void* p = _ptr;
+      _ptr += bytes;
+      _left -= bytes;
+      return p;
+   }
+   void free(void* p, size_t bytes) {
+      bytes = roundUp(bytes);
+      if (p == 0 || bytes > MAX_RECYCLE) return;
+      Chunk* c = (Chunk*)p;
+      c->_next = _recycle[bytes / ARENA_ALIGN];
+      _recycle[bytes / ARENA_ALIGN] = c;
+   }
+   // Construct a T in the arena; its destructor will never be called
+   template <class T> T* create() { return new (alloc(sizeof(T))) T; }
+   template <class T, class A1, class A2>
+   T* create(A1 a1, A2 a2) { return new (alloc(sizeof(T))) T(a1, a2); }
+
+   void release() {
+      for (size_t i = 0, n = _blocks.size(); i < n; ++i) std::free(_blocks[i]);
+      _blocks.clear();
+      _recycle.assign(_recycle.size(), 0);
+      _ptr = 0; _left = 0; _used = 0;
+   }
+   // Bytes handed out since the last release(), recycled chunks included
+   size_t usedBytes() const { return _used; }
+
+private:
+   struct Chunk { Chunk* _next; };
+
+   size_t            _blockSize;
+   char*             _ptr;       // free part of the current block
+   size_t            _left;
+   size_t            _used;
+   vector<Chunk*>    _recycle;   // free lists, indexed by bytes / ARENA_ALIGN
+   vector<void*>     _blocks;
+
+   static size_t roundUp(size_t bytes) {
+      return (bytes + ARENA_ALIGN - 1) & ~size_t(ARENA_ALIGN - 1);
+   }
+   void* newBlock(size_t bytes) {
+      void* b = std::malloc(bytes);
+      if (b == 0) throw bad_alloc();
+      _blocks.push_back(b);
+      return b;
+   }
+
+   Arena(const Arena&);             // not copyable
+   Arena& operator = (const Arena&);
+};
+
+#endif // MY_ARENA_H
@@ -11,7 +11,9 @@
 
 #include <vector>
 #include <bitset>
+#include <new>
 #include <stddef.h>
+#include "myHashMix.h"
 
 using namespace std;
 
@@ -23,13 +25,15 @@ using namespace std;
 // To use HashMap ADT, you should define your own HashKey class.
 // It should at least overload the "()" and "==" operators.
 
+// The two fanins are kept in increasing order, so both orders give the
+// same key
 class faninKey
 {
 public:
-   faninKey(size_t f1, size_t f2) : _fanin1(f1), _fanin2(f2){}
-   size_t operator() () const { return(_fanin1+_fanin2); } 
+   faninKey(size_t f1, size_t f2) : _fanin1(f1<f2? f1: f2), _fanin2(f1<f2? f2: f1){}
+   size_t operator() () const { return(_fanin1*0x9e3779b97f4a7c15ULL ^ _fanin2); } 
    bool operator == (const faninKey& k) const { 
-      return ((_fanin1==k._fanin1) && (_fanin2==k._fanin2) || (_fanin1==k._fanin2) && (_fanin2==k._fanin1)); 
+      return ((_fanin1==k._fanin1) && (_fanin2==k._fanin2)); 
    }
 
 private:
@@ -54,203 +58,200 @@ private:
 };
 
 
-template <class HashKey, class HashData>
+//----------------------------------------------------------------------
+//    HashMap: open addressing with linear probing in one flat array of
+//    nodes. The number of slots is a power of 2 and at least twice the
+//    number of entries; the table doubles when it would be more than half
+//    full. The slot of a key is HashMix()(k()) masked to the table size.
+//    Entries are removed by shifting the following ones back, so there
+//    are no tombstones. Inserting may move the nodes: pointers from
+//    queryAndInsert() and iterators are valid until the next insertion.
+//----------------------------------------------------------------------
+template <class HashKey, class HashData, class HashMix = HashMix64>
 class HashMap
 {
 typedef pair<HashKey, HashData> HashNode;
 
 public:
-   HashMap(size_t b=0) : _numBuckets(0), _buckets(0) { if (b != 0) init(b); }
+   HashMap(size_t b=0) : _numBuckets(0), _size(0), _nodes(0) { if (b != 0) init(b); }
    ~HashMap() { reset(); }
 
-   // [Optional] TODO: implement the HashMap<HashKey, HashData>::iterator
-   // o An iterator should be able to go through all the valid HashNodes
-   //   in the HashMap
-   // o Functions to be implemented:
-   //   - constructor(s), destructor
-   //   - operator '*': return the HashNode
-   //   - ++/--iterator, iterator++/--
-   //   - operators '=', '==', !="
-   //
    class iterator
    {
-      friend class HashMap<HashKey, HashData>;
+      friend class HashMap<HashKey, HashData, HashMix>;
 
    public:
-      iterator(vector<HashNode>* begin , vector<HashNode>* end): _bucket(begin), _end(end), _num(0) {}
-      iterator(){}
+      iterator(const HashMap* map = 0, size_t i = 0) : _map(map), _i(i) {}
       ~iterator() {}
 
-      const HashNode& operator * () const { return (*_bucket)[_num]; }
+      const HashNode& operator * () const { return _map->_nodes[_i]; }
       iterator& operator ++ () {
-         if(_bucket == _end){ return (*this); }
-         if((*_bucket).size()-1==_num || (*_bucket).size()==0){
-            do{
-               if(_bucket == _end){ return (*this); }
-               _bucket++;
-               _num = 0;
-            }while((*_bucket).size()==0);
-         }
-         else{ _num++; }
+         do { ++_i; } while (_i < _map->_numBuckets && !_map->_used[_i]);
          return (*this);
       }
       iterator operator ++ (int) { iterator result = *(this); ++*(this); return result; }
       iterator& operator -- () {
-         if((_num==0 || (*_bucket).size()==0)){
-            do{
-               _bucket--;
-               _num = 0;
-            }while((*_bucket).size()==0);
-         }
-         else{ _num--; }
+         while (_i > 0 && !_map->_used[--_i]) ;
          return (*this);
       }
       iterator operator -- (int) { iterator result = *(this); --*(this); return result; }
-      bool operator != (const iterator& i) const { return (_bucket!=i._bucket)||(_num!=i._num); }
-      bool operator == (const iterator& i) const { return (_bucket==i._bucket)&&(_num==i._num); }
-      iterator& operator = (const iterator& i) { 
-         _bucket = i._bucket; 
-         _num = i._num; 
-         _end = i._end;
-         return *(this); 
-      }
+      bool operator != (const iterator& i) const { return (_i != i._i); }
+      bool operator == (const iterator& i) const { return (_i == i._i); }
 
    private:
-      vector<HashNode>*     _bucket;
-      vector<HashNode>*     _end;
-      size_t                _num;
+      const HashMap*  _map;
+      size_t          _i;
    };
 
-   void init(size_t b) {
-      reset(); _numBuckets = b; _buckets = new vector<HashNode>[b]; }
+   // Make room for b entries without growing
+   void init(size_t b) { reset(); allocate(b); }
    void reset() {
-      _numBuckets = 0;
-      if (_buckets) { delete [] _buckets; _buckets = 0; }
+      clear();
+      ::operator delete(_nodes);
+      _nodes = 0; _numBuckets = 0;
+      _used.clear();
    }
    void clear() {
-      for (size_t i = 0; i < _numBuckets; ++i) _buckets[i].clear();
+      for (size_t i = 0; i < _numBuckets; ++i)
+         if (_used[i]) { _nodes[i].~HashNode(); _used[i] = 0; }
+      _size = 0;
    }
    size_t numBuckets() const { return _numBuckets; }
 
-   vector<HashNode>& operator [] (size_t i) { return _buckets[i]; }
-   const vector<HashNode>& operator [](size_t i) const { return _buckets[i]; }
-
-   // TODO: implement these functions
-   //
    // Point to the first valid data
    iterator begin() const {
-      iterator itr( _buckets, _buckets+_numBuckets );
-      if(_buckets[0].size()==0) ++itr;
-      return itr; 
-   }
-   // Pass the end
-   iterator end() const {
-      iterator itr( _buckets+_numBuckets, _buckets+_numBuckets ); 
+      iterator itr(this, 0);
+      if (_numBuckets == 0) return end();
+      if (!_used[0]) ++itr;
       return itr;
    }
+   // Pass the end
+   iterator end() const { return iterator(this, _numBuckets); }
    // return true if no valid data
-   bool empty() const {
-      for(size_t i=0 ; i< _numBuckets ; ++i){
-         if(_buckets[i].size()!=0) return false;
-      }
-      return true;
-   }
+   bool empty() const { return (_size == 0); }
    // number of valid data
-   size_t size() const {
-      size_t s = 0;
-      for(size_t i=0 ; i< _numBuckets ; ++i){
-         s += _buckets[i].size();
-      }
-      return s;
-   }
+   size_t size() const { return _size; }
 
    // check if k is in the hash...
    // if yes, return true;
    // else return false;
    bool check(const HashKey& k) const {
-      for(size_t i=0 ; i< _buckets[bucketNum(k)].size() ; ++i){
-         if(k == _buckets[bucketNum(k)][i].first){ return true; }
-      }
-      return false;
+      return (_numBuckets != 0 && _used[find(k)]);
    }
 
    // query if k is in the hash...
    // if yes, replace d with the data in the hash and return true;
    // else return false;
    bool query(const HashKey& k, HashData& d) const {
-      for(size_t i=0 ; i< _buckets[bucketNum(k)].size() ; ++i){
-         if(k == _buckets[bucketNum(k)][i].first){
-            d = _buckets[bucketNum(k)][i].second;
-            return true;
-         }
-      }
-      return false;
+      if (_numBuckets == 0) return false;
+      size_t i = find(k);
+      if (!_used[i]) return false;
+      d = _nodes[i].second;
+      return true;
    }
 
    // update the entry in hash that is equal to k (i.e. == return true)
    // if found, update that entry with d and return true;
    // else insert d into hash as a new entry and return false;
-   bool update(const HashKey& k, HashData& d) {
-      for(size_t i=0 ; i< _buckets[bucketNum(k)].size() ; ++i){
-         if(k == _buckets[bucketNum(k)][i].first){
-            _buckets[bucketNum(k)][i].second = d;
-            return true;
-         }
-      }
-      HashNode n(k,d);
-      _buckets[bucketNum(k)].push_back(n);
-      return false;   
+   bool update(const HashKey& k, const HashData& d) {
+      size_t i = findForInsert(k);
+      if (_used[i]) { _nodes[i].second = d; return true; }
+      add(i, k, d);
+      return false;
    }
 
    // return true if inserted d successfully (i.e. k is not in the hash)
    // return false is k is already in the hash ==> will not insert
    bool insert(const HashKey& k, const HashData& d) {
-      if(check(k)){ return false; }
-      else{ 
-         HashNode n(k,d);
-         _buckets[bucketNum(k)].push_back(n);
-         return true;
-      }
+      size_t i = findForInsert(k);
+      if (_used[i]) return false;
+      add(i, k, d);
+      return true;
    }
 
    // return true if removed successfully (i.e. k is in the hash)
    // return fasle otherwise (i.e. nothing is removed)
    bool remove(const HashKey& k) {
-      for(size_t i=0 ; i< _buckets[bucketNum(k)].size() ; ++i){
-         if(k == _buckets[bucketNum(k)][i]){
-            _buckets[bucketNum(k)].erase(_buckets[bucketNum(k)].begin()+i);
-            return true;
-         }
+      if (_numBuckets == 0) return false;
+      size_t i = find(k);
+      if (!_used[i]) return false;
+      _nodes[i].~HashNode();
+      _used[i] = 0;
+      --_size;
+      // Move back every following entry that may take the freed slot
+      const size_t mask = _numBuckets - 1;
+      for (size_t j = (i + 1) & mask; _used[j]; j = (j + 1) & mask) {
+         const size_t home = bucketNum(_nodes[j].first);
+         if (((j - home) & mask) < ((j - i) & mask)) continue;
+         new (&_nodes[i]) HashNode(_nodes[j]);
+         _used[i] = 1;
+         _nodes[j].~HashNode();
+         _used[j] = 0;
+         i = j;
       }
-      return false;
+      return true;
    }
 
    // query if k is in the hash...
    // if yes, replace d with the data in the hash and return true;
    // else, insert d in the hash and return false;
-   bool queryAndInsert(const HashKey& k, HashData*& d){
-      size_t bn = bucketNum(k);
-      for(size_t i=0 ; i< _buckets[bn].size() ; ++i){
-         if(k == _buckets[bn][i].first){
-            d = & (_buckets[bn][i].second);
-            return true;
-         }
-      }
-      HashNode n(k,*d);
-      _buckets[bn].push_back(n);
-      return false;
+   bool queryAndInsert(const HashKey& k, HashData*& d) {
+      size_t i = findForInsert(k);
+      if (!_used[i]) { add(i, k, *d); return false; }
+      d = &(_nodes[i].second);
+      return true;
    }
 
-
-
 private:
-   // Do not add any extra data member
-   size_t                   _numBuckets;
-   vector<HashNode>*        _buckets;
+   size_t                   _numBuckets;   // 0 or a power of 2
+   size_t                   _size;
+   HashNode*                _nodes;        // constructed where _used is set
+   vector<unsigned char>    _used;
 
    size_t bucketNum(const HashKey& k) const {
-      return (k() % _numBuckets); }
+      return (HashMix()(k()) & (_numBuckets - 1)); }
+   // The slot of k, or the empty slot that ends its probe sequence
+   size_t find(const HashKey& k) const {
+      size_t i = bucketNum(k);
+      while (_used[i] && !(k == _nodes[i].first)) i = (i + 1) & (_numBuckets - 1);
+      return i;
+   }
+   // As find(), after growing the table if one more entry would make it
+   // more than half full
+   size_t findForInsert(const HashKey& k) {
+      if (2 * (_size + 1) > _numBuckets) rehash(_size + 1);
+      return find(k);
+   }
+   void add(size_t i, const HashKey& k, const HashData& d) {
+      new (&_nodes[i]) HashNode(k, d);
+      _used[i] = 1;
+      ++_size;
+   }
+   void allocate(size_t b) {
+      size_t n = 8;
+      while (n < 2 * b) n *= 2;
+      _nodes = (HashNode*)::operator new(n * sizeof(HashNode));
+      _used.assign(n, 0);
+      _numBuckets = n;
+   }
+   void rehash(size_t b) {
+      HashNode* nodes = _nodes;
+      vector<unsigned char> used;
+      used.swap(_used);
+      const size_t n = _numBuckets;
+      allocate(b > _size * 2? b: _size * 2);
+      for (size_t i = 0; i < n; ++i) {
+         if (!used[i]) continue;
+         size_t j = find(nodes[i].first);
+         new (&_nodes[j]) HashNode(nodes[i]);
+         _used[j] = 1;
+         nodes[i].~HashNode();
+      }
+      ::operator delete(nodes);
+   }
 
+   HashMap(const HashMap&);               // not copyable
+   HashMap& operator = (const HashMap&);
 };
 
 
@@ -272,7 +273,14 @@ private:
 // private:
 // }; 
 // 
-template <class CacheKey, class CacheData>
+//----------------------------------------------------------------------
+//    Cache: a direct-mapped computed table. Every key has exactly one
+//    slot, HashMix()(k()) masked to the size (rounded up to a power of 2),
+//    and a write replaces whatever was there, so a read may miss an entry
+//    that was written before. All the memory is taken by init(); read()
+//    and write() are O(1) and never allocate.
+//----------------------------------------------------------------------
+template <class CacheKey, class CacheData, class HashMix = HashMix64>
 class Cache
 {
 typedef pair<CacheKey, CacheData> CacheNode;
@@ -284,21 +292,32 @@ public:
 
    // NO NEED to implement Cache::iterator class
 
-   // TODO: implement these functions
-   //
-   // Initialize _cache with size s
-   void init(size_t s) { reset(); _size = s; _cache = new CacheNode[s]; }
-   void reset() {  _size = 0; if (_cache) { delete [] _cache; _cache = 0; } }
+   // Initialize _cache with at least s entries
+   void init(size_t s) {
+      reset();
+      _size = 1;
+      while (_size < s) _size *= 2;
+      _cache = (CacheNode*)::operator new(_size * sizeof(CacheNode));
+      _valid.assign(_size, 0);
+   }
+   void reset() {
+      clear();
+      ::operator delete(_cache);
+      _cache = 0; _size = 0;
+      _valid.clear();
+   }
+   // Forget all the entries but keep the memory
+   void clear() {
+      for (size_t i = 0; i < _size; ++i)
+         if (_valid[i]) { _cache[i].~CacheNode(); _valid[i] = 0; }
+   }
 
    size_t size() const { return _size; }
 
-   CacheNode& operator [] (size_t i) { return _cache[i]; }
-   const CacheNode& operator [](size_t i) const { return _cache[i]; }
-
    // return false if cache miss
    bool read(const CacheKey& k, CacheData& d) const {
-      size_t i = k() % _size;
-      if (k == _cache[i].first) {
+      size_t i = slot(k);
+      if (_valid[i] && k == _cache[i].first) {
          d = _cache[i].second;
          return true;
       }
@@ -306,15 +325,26 @@ public:
    }
    // If k is already in the Cache, overwrite the CacheData
    void write(const CacheKey& k, const CacheData& d) {
-      size_t i = k() % _size;
-      _cache[i].first = k;
-      _cache[i].second = d;
+      size_t i = slot(k);
+      if (_valid[i]) {
+         _cache[i].first = k;
+         _cache[i].second = d;
+      }
+      else {
+         new (&_cache[i]) CacheNode(k, d);
+         _valid[i] = 1;
+      }
    }
 
 private:
-   // Do not add any extra data member
-   size_t         _size;
-   CacheNode*     _cache;
+   size_t                  _size;      // 0 or a power of 2
+   CacheNode*              _cache;     // constructed where _valid is set
+   vector<unsigned char>   _valid;
+
+   size_t slot(const CacheKey& k) const { return (HashMix()(k()) & (_size - 1)); }
+
+   Cache(const Cache&);                // not copyable
+   Cache& operator = (const Cache&);
 };
 
 
@@ -0,0 +1,36 @@
+/****************************************************************************
+  FileName     [ myHashMix.h ]
+  PackageName  [ util ]
+  Synopsis     [ Define hash mixing functions ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2009-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_HASH_MIX_H
+#define MY_HASH_MIX_H
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------
+//    HashMix64: the default mixer of HashMap and HashSet. The key gives
+//    a raw hash with operator (), and the mixer spreads it over all 64
+//    bits (the splitmix64 finalizer), so that keys made of pointers or
+//    small integers do not pile up in a few slots of the table.
+//----------------------------------------------------------------------
+struct HashMix64
+{
+   size_t operator () (size_t h) const {
+      h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+      h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+      h ^= h >> 31;
+      return h;
+   }
+};
+
+// Use the raw hash as it is, for keys that are already well spread
+struct HashMixNone
+{
+   size_t operator () (size_t h) const { return h; }
+};
+
+#endif // MY_HASH_MIX_H
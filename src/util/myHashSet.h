@@ -10,6 +10,9 @@
 #define MY_HASH_SET_H
 
 #include <vector>
+#include <new>
+#include <stddef.h>
+#include "myHashMix.h"
 
 using namespace std;
 
@@ -19,186 +22,191 @@ using namespace std;
 // To use HashSet ADT,
 // the class "Data" should at least overload the "()" and "==" operators.
 //
-// "operator ()" is to generate the hash key (size_t)
-// that will be % by _numBuckets to get the bucket number.
+// "operator ()" is to generate the hash key (size_t), which is mixed by
+// HashMix and masked to the table size to get the bucket number.
 // ==> See "bucketNum()"
 //
 // "operator ==" is to check whether there has already been
 // an equivalent "Data" object in the HashSet.
 // Note that HashSet does not allow equivalent nodes to be inserted
 //
-template <class Data>
+// The table is laid out as HashMap in myHashMap.h: open addressing with
+// linear probing, a power-of-2 number of slots, at most half full, and
+// removal by shifting back. Iterators are valid until the next insertion.
+//
+template <class Data, class HashMix = HashMix64>
 class HashSet
 {
 public:
-   HashSet(size_t b = 0) : _numBuckets(0), _buckets(0) { if (b != 0) init(b); }
+   HashSet(size_t b = 0) : _numBuckets(0), _size(0), _data(0) { if (b != 0) init(b); }
    ~HashSet() { reset(); }
 
-   // TODO: implement the HashSet<Data>::iterator
-   // o An iterator should be able to go through all the valid Data
-   //   in the Hash
-   // o Functions to be implemented:
-   //   - constructor(s), destructor
-   //   - operator '*': return the HashNode
-   //   - ++/--iterator, iterator++/--
-   //   - operators '=', '==', !="
-   //
    class iterator
    {
-      friend class HashSet<Data>;
+      friend class HashSet<Data, HashMix>;
 
    public:
-      iterator(vector<Data>* begin , vector<Data>* end): _bucket(begin), _end(end), _num(0) {}
-      iterator(const iterator& i) : _bucket(i._bucket), _end(i._end), _num(i._num) {}
+      iterator(const HashSet* set = 0, size_t i = 0) : _set(set), _i(i) {}
       ~iterator() {}
 
-      const Data& operator * () const { return (*_bucket)[_num]; }
+      const Data& operator * () const { return _set->_data[_i]; }
       iterator& operator ++ () {
-         if(_bucket == _end){ return (*this); }
-         if((*_bucket).size()-1==_num || (*_bucket).size()==0){
-            do{
-               if(_bucket == _end){ return (*this); }
-               _bucket++;
-               _num = 0;
-            }while((*_bucket).size()==0);
-         }
-         else{ _num++; }
+         do { ++_i; } while (_i < _set->_numBuckets && !_set->_used[_i]);
          return (*this);
       }
       iterator operator ++ (int) { iterator result = *(this); ++*(this); return result; }
       iterator& operator -- () {
-         if((_num==0 || (*_bucket).size()==0)){
-            do{
-               _bucket--;
-               _num = 0;
-            }while((*_bucket).size()==0);
-         }
-         else{ _num--; }
+         while (_i > 0 && !_set->_used[--_i]) ;
          return (*this);
       }
       iterator operator -- (int) { iterator result = *(this); --*(this); return result; }
-      bool operator != (const iterator& i) const { return (_bucket!=i._bucket)||(_num!=i._num); }
-      bool operator == (const iterator& i) const { return (_bucket==i._bucket)&&(_num==i._num); }
-      iterator& operator = (const iterator& i) { 
-         _bucket = i._bucket; 
-         _num = i._num; 
-         return *(this); 
-      }
+      bool operator != (const iterator& i) const { return (_i != i._i); }
+      bool operator == (const iterator& i) const { return (_i == i._i); }
 
    private:
-      vector<Data>*     _bucket;
-      vector<Data>*     _end;
-      size_t            _num;
+      const HashSet*  _set;
+      size_t          _i;
    };
 
-   void init(size_t b) { _numBuckets = b; _buckets = new vector<Data>[b]; }
+   // Make room for b entries without growing
+   void init(size_t b) { reset(); allocate(b); }
    void reset() {
-      _numBuckets = 0;
-      if (_buckets) { delete [] _buckets; _buckets = 0; }
+      clear();
+      ::operator delete(_data);
+      _data = 0; _numBuckets = 0;
+      _used.clear();
    }
    void clear() {
-      for (size_t i = 0; i < _numBuckets; ++i) _buckets[i].clear();
+      for (size_t i = 0; i < _numBuckets; ++i)
+         if (_used[i]) { _data[i].~Data(); _used[i] = 0; }
+      _size = 0;
    }
    size_t numBuckets() const { return _numBuckets; }
 
-   vector<Data>& operator [] (size_t i) { return _buckets[i]; }
-   const vector<Data>& operator [](size_t i) const { return _buckets[i]; }
-
-   // TODO: implement these functions
-   //
    // Point to the first valid data
-   iterator begin() const { 
-      iterator itr( _buckets, _buckets+_numBuckets );
-      if(_buckets[0].size()==0) ++itr;
-      return itr; 
+   iterator begin() const {
+      iterator itr(this, 0);
+      if (_numBuckets == 0) return end();
+      if (!_used[0]) ++itr;
+      return itr;
    }
    // Pass the end
-   iterator end() const { 
-      iterator itr( _buckets+_numBuckets, _buckets+_numBuckets ); 
-      return itr;
-   }   
+   iterator end() const { return iterator(this, _numBuckets); }
    // return true if no valid data
-   bool empty() const {
-      for(size_t i=0 ; i< _numBuckets ; ++i){
-         if(_buckets[i].size()!=0) return false;
-      }
-      return true;
-   }   
+   bool empty() const { return (_size == 0); }
    // number of valid data
-   size_t size() const {
-      size_t s = 0;
-      for(size_t i=0 ; i< _numBuckets ; ++i){
-         s += _buckets[i].size();
-      }
-      return s;
-   }
+   size_t size() const { return _size; }
 
    // check if d is in the hash...
    // if yes, return true;
    // else return false;
    bool check(const Data& d) const {
-      for(size_t i=0 ; i< _buckets[bucketNum(d)].size() ; ++i){
-         if(d == _buckets[bucketNum(d)][i]){ return true; }
-      }
-      return false;
+      return (_numBuckets != 0 && _used[find(d)]);
    }
-   
+
    // query if d is in the hash...
    // if yes, replace d with the data in the hash and return true;
    // else return false;
    bool query(Data& d) const {
-      for(size_t i=0 ; i< _buckets[bucketNum(d)].size() ; ++i){
-         if(d == _buckets[bucketNum(d)][i]){
-            _buckets[bucketNum(d)][i] = d;
-            return true;
-         }
-      }
-      return false;
+      if (_numBuckets == 0) return false;
+      size_t i = find(d);
+      if (!_used[i]) return false;
+      d = _data[i];
+      return true;
    }
 
    // update the entry in hash that is equal to d (i.e. == return true)
    // if found, update that entry with d and return true;
    // else insert d into hash as a new entry and return false;
    bool update(const Data& d) {
-      for(size_t i=0 ; i< _buckets[bucketNum(d)].size() ; ++i){
-         if(d == _buckets[bucketNum(d)][i]){
-            _buckets[bucketNum(d)][i] = d;
-            return true;
-         }
-      }
-      _buckets[bucketNum(d)].push_back(d);
+      size_t i = findForInsert(d);
+      if (_used[i]) { _data[i] = d; return true; }
+      add(i, d);
       return false;
    }
 
    // return true if inserted successfully (i.e. d is not in the hash)
    // return false is d is already in the hash ==> will not insert
    bool insert(const Data& d) {
-      if(check(d)){ return false; }
-      else{ 
-         _buckets[bucketNum(d)].push_back(d);
-         return true;
-      }
+      size_t i = findForInsert(d);
+      if (_used[i]) return false;
+      add(i, d);
+      return true;
    }
 
    // return true if removed successfully (i.e. d is in the hash)
    // return fasle otherwise (i.e. nothing is removed)
    bool remove(const Data& d) {
-      for(size_t i=0 ; i< _buckets[bucketNum(d)].size() ; ++i){
-         if(d == _buckets[bucketNum(d)][i]){
-            _buckets[bucketNum(d)].erase(_buckets[bucketNum(d)].begin()+i);
-            return true;
-         }
+      if (_numBuckets == 0) return false;
+      size_t i = find(d);
+      if (!_used[i]) return false;
+      _data[i].~Data();
+      _used[i] = 0;
+      --_size;
+      // Move back every following entry that may take the freed slot
+      const size_t mask = _numBuckets - 1;
+      for (size_t j = (i + 1) & mask; _used[j]; j = (j + 1) & mask) {
+         const size_t home = bucketNum(_data[j]);
+         if (((j - home) & mask) < ((j - i) & mask)) continue;
+         new (&_data[i]) Data(_data[j]);
+         _used[i] = 1;
+         _data[j].~Data();
+         _used[j] = 0;
+         i = j;
       }
-      return false;
+      return true;
    }
 
 private:
-   // Do not add any extra data member
-   size_t            _numBuckets;
-   vector<Data>*     _buckets;
+   size_t                  _numBuckets;   // 0 or a power of 2
+   size_t                  _size;
+   Data*                   _data;         // constructed where _used is set
+   vector<unsigned char>   _used;
 
    size_t bucketNum(const Data& d) const {
-      return (d() % _numBuckets); }
+      return (HashMix()(d()) & (_numBuckets - 1)); }
+   // The slot of d, or the empty slot that ends its probe sequence
+   size_t find(const Data& d) const {
+      size_t i = bucketNum(d);
+      while (_used[i] && !(d == _data[i])) i = (i + 1) & (_numBuckets - 1);
+      return i;
+   }
+   // As find(), after growing the table if one more entry would make it
+   // more than half full
+   size_t findForInsert(const Data& d) {
+      if (2 * (_size + 1) > _numBuckets) rehash(_size + 1);
+      return find(d);
+   }
+   void add(size_t i, const Data& d) {
+      new (&_data[i]) Data(d);
+      _used[i] = 1;
+      ++_size;
+   }
+   void allocate(size_t b) {
+      size_t n = 8;
+      while (n < 2 * b) n *= 2;
+      _data = (Data*)::operator new(n * sizeof(Data));
+      _used.assign(n, 0);
+      _numBuckets = n;
+   }
+   void rehash(size_t b) {
+      Data* data = _data;
+      vector<unsigned char> used;
+      used.swap(_used);
+      const size_t n = _numBuckets;
+      allocate(b > _size * 2? b: _size * 2);
+      for (size_t i = 0; i < n; ++i) {
+         if (!used[i]) continue;
+         size_t j = find(data[i]);
+         new (&_data[j]) Data(data[i]);
+         _used[j] = 1;
+         data[i].~Data();
+      }
+      ::operator delete(data);
+   }
+
+   HashSet(const HashSet&);               // not copyable
+   HashSet& operator = (const HashSet&);
 };
 
 #endif // MY_HASH_SET_H
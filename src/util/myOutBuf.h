@@ -0,0 +1,68 @@
+/****************************************************************************
+  FileName     [ myOutBuf.h ]
+  PackageName  [ util ]
+  Synopsis     [ Define buffered output ADT ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2007-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_OUT_BUF_H
+#define MY_OUT_BUF_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    OutBuf: format text and bytes in memory and pass them to an ostream
+//    in large blocks, never flushing the stream itself
+//----------------------------------------------------------------------
+class OutBuf
+{
+public:
+   OutBuf(ostream& os, size_t size = 1 << 16) : _os(os), _buf(size), _num(0) {}
+   ~OutBuf() { flush(); }
+
+   OutBuf& operator << (char c) { put(c); return *this; }
+   OutBuf& operator << (const char* s) { write(s, strlen(s)); return *this; }
+   OutBuf& operator << (const string& s) { write(s.data(), s.size()); return *this; }
+   OutBuf& operator << (unsigned long n) {
+      char digit[24];
+      size_t i = sizeof(digit);
+      do { digit[--i] = char('0' + n % 10); n /= 10; } while (n != 0);
+      write(digit + i, sizeof(digit) - i);
+      return *this;
+   }
+   OutBuf& operator << (unsigned n) { return (*this) << (unsigned long)n; }
+   OutBuf& operator << (int n) {
+      if (n < 0) { put('-'); return (*this) << (unsigned long)(-(long)n); }
+      return (*this) << (unsigned long)n;
+   }
+
+   void put(char c) {
+      if (_num == _buf.size()) flush();
+      _buf[_num++] = c;
+   }
+   void write(const char* s, size_t n) {
+      if (_num + n > _buf.size()) {
+         flush();
+         if (n > _buf.size()) { _os.write(s, n); return; }
+      }
+      memcpy(&_buf[_num], s, n);
+      _num += n;
+   }
+   void flush() {
+      if (_num != 0) _os.write(&_buf[0], _num);
+      _num = 0;
+   }
+
+private:
+   ostream&       _os;
+   vector<char>   _buf;
+   size_t         _num;
+};
+
+#endif // MY_OUT_BUF_H
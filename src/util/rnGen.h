@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <stdlib.h>  
 #include <limits.h>
+#include <stddef.h>
 
 #define my_srandom  srandom
 #define my_random   random
@@ -26,5 +27,78 @@ class RandomNumGen
       }
 };
 
+//----------------------------------------------------------------------
+//    RandomWordGen: 64-bit random words from four xoshiro256** streams,
+//    used in turn, so that fill() can step the four of them side by side.
+//    seed() derives the streams with splitmix64 and a given seed always
+//    gives the same words. A copy advanced by jump() (2^128 steps per
+//    stream) does not meet the original, so each thread takes its own
+//    copy jumped a different number of times.
+//    Not thread-safe; every thread needs its own object.
+//----------------------------------------------------------------------
+class RandomWordGen
+{
+   public:
+      enum { LANES = 4 };
+
+      RandomWordGen(size_t seed = 0) { this->seed(seed); }
+
+      void seed(size_t seed) {
+         for (int i = 0; i < 4; ++i)
+            for (int l = 0; l < LANES; ++l) _s[i][l] = splitMix(seed);
+         _lane = 0;
+      }
+      size_t operator() () {
+         const size_t r = step(_lane);
+         _lane = (_lane + 1) % LANES;
+         return r;
+      }
+      // Same words as n calls of operator ()
+      void fill(size_t* p, size_t n) {
+         size_t i = 0;
+         for (; i < n && _lane != 0; ++i) p[i] = (*this)();
+         for (; i + LANES <= n; i += LANES)
+            for (int l = 0; l < LANES; ++l) p[i+l] = step(l);
+         for (; i < n; ++i) p[i] = (*this)();
+      }
+      void jump() {
+         static const size_t J[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                      0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+         for (int l = 0; l < LANES; ++l) {
+            size_t t[4] = { 0, 0, 0, 0 };
+            for (int j = 0; j < 4; ++j)
+               for (int b = 0; b < 64; ++b) {
+                  if (J[j] & (size_t(1) << b))
+                     for (int i = 0; i < 4; ++i) t[i] ^= _s[i][l];
+                  step(l);
+               }
+            for (int i = 0; i < 4; ++i) _s[i][l] = t[i];
+         }
+      }
+
+   private:
+      size_t   _s[4][LANES];   // word i of the state of each stream
+      int      _lane;          // stream of the next operator ()
+
+      static size_t rotl(size_t x, int k) { return (x << k) | (x >> (64 - k)); }
+      static size_t splitMix(size_t& x) {
+         size_t z = (x += 0x9e3779b97f4a7c15ULL);
+         z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+         z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+         return z ^ (z >> 31);
+      }
+      size_t step(int l) {
+         const size_t r = rotl(_s[1][l] * 5, 7) * 9;
+         const size_t t = _s[1][l] << 17;
+         _s[2][l] ^= _s[0][l];
+         _s[3][l] ^= _s[1][l];
+         _s[1][l] ^= _s[2][l];
+         _s[0][l] ^= _s[3][l];
+         _s[2][l] ^= t;
+         _s[3][l] = rotl(_s[3][l], 45);
+         return r;
+      }
+};
+
 #endif // RN_GEN_H
 